@@ -0,0 +1,172 @@
+/*
+ * ekf_propagation_bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: pauvsi
+ *
+ * times the per imu sample cost of predicting the ekf state to each frame at 200, 500 and 1000 Hz
+ * before: the old predict loop. the messages are copied out of a vector buffer every frame and
+ * state = transitionState(state, dt) copies the state in, into a new xNew and back out for every sample
+ * after: addIMUMessage into the ring buffer and predictInPlace at every frame
+ * the covariance is propagated every sample on both sides
+ *
+ * the vioekf's tf listener needs a node handle so run it with a roscore up
+ * usage: ekf_propagation_bench [frames = 2000]
+ */
+
+#include <vector>
+#include <cstdlib>
+#include <ros/ros.h>
+#include <sensor_msgs/Imu.h>
+
+#include "VIOEKF.h"
+#include "VIOState.hpp"
+
+#define BENCH_FRAME_RATE 30
+
+static std::vector<sensor_msgs::Imu> makeMessages(int n, double rate)
+{
+	std::vector<sensor_msgs::Imu> msgs(n);
+	for(int i = 0; i < n; i++)
+	{
+		msgs[i].header.stamp = ros::Time(1.0 + i / rate);
+		msgs[i].linear_acceleration.x = 0.1 * (rand() % 10);
+		msgs[i].linear_acceleration.z = 9.8;
+		msgs[i].angular_velocity.z = 0.01 * (rand() % 10);
+	}
+	return msgs;
+}
+
+/*
+ * the old transitionState took the state by value and built a new one to return
+ */
+static VIOState oldTransitionState(VIOEKF& ekf, VIOState x, double dt)
+{
+	VIOState xNew;
+	xNew = x;
+	ekf.transitionStateInPlace(xNew, dt);
+	return xNew;
+}
+
+/*
+ * the old getMessagesBetweenTimes. it scans the whole buffer and copies the useful messages out
+ * the buffer was never trimmed so the scan grows with the run time like it did
+ */
+static int oldGetMessagesBetweenTimes(const std::vector<sensor_msgs::Imu>& buffer, ros::Time t0, ros::Time t1, std::vector<sensor_msgs::Imu>& returnBuffer)
+{
+	int returnBufferSize = 0;
+	std::vector<sensor_msgs::Imu> newImuBuffer;
+
+	double startTime = t0.toSec();
+	double endTime = t1.toSec();
+
+	for(int i = 0; i < buffer.size(); i++)
+	{
+		double msgTime = buffer.at(i).header.stamp.toSec();
+
+		//if this message is useful
+		if(msgTime > startTime && msgTime < endTime)
+		{
+			returnBuffer.push_back(buffer.at(i));
+			returnBufferSize++;
+		}
+		if(msgTime > endTime)
+		{
+			newImuBuffer.push_back(buffer.at(i));
+		}
+	}
+
+	return returnBufferSize;
+}
+
+/*
+ * the old predict with the covariance propagated every sample
+ */
+static VIOState oldPredict(VIOEKF& ekf, const std::vector<sensor_msgs::Imu>& buffer, VIOState lastState, ros::Time predictionTime)
+{
+	VIOState state = lastState;
+	std::vector<sensor_msgs::Imu> imuMsgs;
+
+	int imuMsgsSize = oldGetMessagesBetweenTimes(buffer, lastState.getTime(), predictionTime, imuMsgs);
+
+	if(imuMsgsSize > 0)
+	{
+		for(int i = 0; i < imuMsgs.size(); i++)
+		{
+			if(!state.timeSet)
+			{
+				state.setTime(imuMsgs.at(i).header.stamp);
+			}
+
+			double dt = imuMsgs.at(i).header.stamp.toSec() - state.getTime().toSec();
+			ekf.propagateCovariance(state, dt, state.covariance);
+			state = oldTransitionState(ekf, state, dt);
+			state.setAlpha(imuMsgs.at(i).linear_acceleration.x, imuMsgs.at(i).linear_acceleration.y, imuMsgs.at(i).linear_acceleration.z);
+			state.setOmega(imuMsgs.at(i).angular_velocity.x, imuMsgs.at(i).angular_velocity.y, imuMsgs.at(i).angular_velocity.z);
+		}
+	}
+
+	double dt = predictionTime.toSec() - state.getTime().toSec();
+	ekf.propagateCovariance(state, dt, state.covariance);
+	state = oldTransitionState(ekf, state, dt);
+	state.setTime(predictionTime);
+
+	return state;
+}
+
+int main(int argc, char** argv)
+{
+	ros::init(argc, argv, "ekf_propagation_bench");
+	int frames = (argc > 1) ? atoi(argv[1]) : 2000;
+
+	int rates[] = {200, 500, 1000};
+	for(int r = 0; r < 3; r++)
+	{
+		int perFrame = rates[r] / BENCH_FRAME_RATE;
+		int n = perFrame * frames;
+		std::vector<sensor_msgs::Imu> msgs = makeMessages(n, rates[r]);
+		double frameDt = 1.0 / BENCH_FRAME_RATE;
+		double sink = 0;
+
+		// before
+		VIOEKF oldEKF;
+		oldEKF.imu2odom.setIdentity();
+		std::vector<sensor_msgs::Imu> imuMessageBuffer;
+		VIOState oldState;
+
+		ros::WallTime start = ros::WallTime::now();
+		for(int f = 0; f < frames; f++)
+		{
+			for(int i = f * perFrame; i < (f + 1) * perFrame; i++)
+			{
+				imuMessageBuffer.push_back(msgs[i]);
+			}
+			oldState = oldPredict(oldEKF, imuMessageBuffer, oldState, ros::Time(1.0 + (f + 1) * frameDt));
+			sink += oldState.x();
+		}
+		double before = (ros::WallTime::now().toSec() - start.toSec()) / n;
+
+		// after. the buffer is evicted once per frame like the vio does
+		VIOEKF ekf;
+		ekf.imu2odom.setIdentity();
+		VIOState state;
+
+		start = ros::WallTime::now();
+		for(int f = 0; f < frames; f++)
+		{
+			for(int i = f * perFrame; i < (f + 1) * perFrame; i++)
+			{
+				ekf.addIMUMessage(msgs[i]);
+			}
+			ekf.predictInPlace(state, ros::Time(1.0 + (f + 1) * frameDt));
+			ekf.evictIMUBefore(state.getTime());
+			sink += state.x();
+		}
+		double after = (ros::WallTime::now().toSec() - start.toSec()) / n;
+
+		ROS_INFO("%d Hz: old predict %.0f ns, predictInPlace %.0f ns per sample (%g)",
+				rates[r], before * 1e9, after * 1e9, sink);
+	}
+
+	return 0;
+}
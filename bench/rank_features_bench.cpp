@@ -0,0 +1,110 @@
+/*
+ * rank_features_bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: pauvsi
+ *
+ * times the ranking and top n selection of new feature candidates
+ * the old path is the old rankFeatures: the scalar per candidate exp() loop followed by a std::sort of
+ * the whole Feature vector with the by value comparator
+ * the new path is Frame::rankFeatures into a quality array and Frame::selectBestFeatures on indexes
+ *
+ * usage: rank_features_bench [candidates = 5000] [n = 50] [iterations = 2000]
+ */
+
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <ros/ros.h>
+
+#include "Frame.h"
+#include "Feature.h"
+
+#define BENCH_KILL_RADIUS 210
+
+// the comparator the old path used. it takes the features by value
+static bool wayToSort(Feature i, Feature j)
+{
+	return i.quality<j.quality;
+}
+
+/*
+ * the ranking before the batched kernel
+ * the features end up sorted in ascending order of quality so the n best are the last n
+ */
+static void oldRankFeatures(std::vector<Feature>& features, int killRadius)
+{
+	int size = features.size();
+	for(int i=0; i<size; ++i)
+	{
+		if(features.at(i).quality != -1.0)
+		{
+			features.at(i).quality = (0.8*features.at(i).feature.response +
+					0.2*features.at(i).feature.response *
+					(1/(1+exp(-(5-(10*features.at(i).radius/killRadius))))));
+		}
+	}
+	std::sort(features.begin(), features.end(), wayToSort);
+}
+
+int main(int argc, char** argv)
+{
+	int nCandidates = (argc > 1) ? atoi(argv[1]) : 5000;
+	int n = (argc > 2) ? atoi(argv[2]) : 50;
+	int iterations = (argc > 3) ? atoi(argv[3]) : 2000;
+
+	srand(1);
+	std::vector<Feature> candidates(nCandidates);
+	for(auto& e : candidates)
+	{
+		e.feature.response = 10 + rand() % 100;
+		e.radius = BENCH_KILL_RADIUS * (float)rand() / RAND_MAX;
+		e.original_pxl = cv::Point2f(rand() % 640, rand() % 480);
+	}
+
+	Frame frame;
+
+	// old path. the candidates are copied every iteration because the sort reorders them
+	double sink = 0;
+	std::vector<Feature> work;
+	ros::WallTime start = ros::WallTime::now();
+	for(int it = 0; it < iterations; it++)
+	{
+		work = candidates;
+		oldRankFeatures(work, BENCH_KILL_RADIUS);
+		sink += work.back().quality;
+	}
+	double oldTime = (ros::WallTime::now().toSec() - start.toSec()) / iterations;
+
+	// new path. the candidates are only read
+	std::vector<float> quality;
+	std::vector<int> best;
+	start = ros::WallTime::now();
+	for(int it = 0; it < iterations; it++)
+	{
+		work = candidates; // the same copy so only the ranking differs
+		frame.rankFeatures(work, BENCH_KILL_RADIUS, quality);
+		Frame::selectBestFeatures(quality, n, best);
+		sink += quality.at(best.at(0));
+		FrameArena::get().reset(); // like the end of VIO::run
+	}
+	double newTime = (ros::WallTime::now().toSec() - start.toSec()) / iterations;
+
+	// both must pick the same quality threshold
+	work = candidates;
+	oldRankFeatures(work, BENCH_KILL_RADIUS);
+	float oldWorst = work.at(work.size() - std::min(n, nCandidates)).quality;
+	float newWorst = quality.at(best.at(0));
+	for(auto& i : best)
+	{
+		newWorst = std::min(newWorst, quality.at(i));
+	}
+
+	ROS_INFO("%d candidates, top %d, %d iterations", nCandidates, n, iterations);
+	ROS_INFO("old scalar exp + sort of the features: %.2f us", oldTime * 1e6);
+	ROS_INFO("new batched kernel + nth_element on indexes: %.2f us", newTime * 1e6);
+	ROS_INFO("worst selected quality old %f new %f (%g)", oldWorst, newWorst, sink);
+
+	return (std::abs(oldWorst - newWorst) <= 1e-3 * std::abs(oldWorst)) ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+/*
+ * AllocationProbe.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "AllocationProbe.h"
+
+#include <cstdlib>
+#include <cerrno>
+
+#if ALLOCATION_PROBE
+
+/*
+ * glibc's own allocator. malloc and friends defined here interpose it for the whole process
+ * including opencv's fastMalloc and operator new inside the shared libraries
+ */
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+extern "C" void __libc_free(void* p);
+
+// initial exec so reading them never allocates. the library is always loaded at startup
+static thread_local bool watched __attribute__((tls_model("initial-exec"))) = false;
+static thread_local unsigned long allocations __attribute__((tls_model("initial-exec"))) = 0;
+
+static inline void countAllocation()
+{
+	if(watched)
+	{
+		allocations++;
+	}
+}
+
+extern "C" void* malloc(size_t size)
+{
+	countAllocation();
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size)
+{
+	countAllocation();
+	return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* p, size_t size)
+{
+	countAllocation();
+	return __libc_realloc(p, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size)
+{
+	countAllocation();
+	return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size)
+{
+	countAllocation();
+	return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** p, size_t alignment, size_t size)
+{
+	countAllocation();
+	*p = __libc_memalign(alignment, size);
+	return (*p != NULL || size == 0) ? 0 : ENOMEM;
+}
+
+extern "C" void free(void* p)
+{
+	__libc_free(p);
+}
+
+bool AllocationProbe::enabled()
+{
+	return true;
+}
+
+void AllocationProbe::watchThisThread()
+{
+	watched = true;
+}
+
+unsigned long AllocationProbe::count()
+{
+	return allocations;
+}
+
+#else
+
+bool AllocationProbe::enabled()
+{
+	return false;
+}
+
+void AllocationProbe::watchThisThread()
+{
+}
+
+unsigned long AllocationProbe::count()
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * AllocationProbe.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_ALLOCATIONPROBE_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_ALLOCATIONPROBE_H_
+
+/*
+ * counts the heap allocations of the watched threads by interposing glibc's malloc
+ * so cv::Mat buffers and everything inside the shared libraries are seen, not just operator new
+ * the other threads (roscpp's spinners, the imu callback) are not counted
+ * this is only compiled in if ALLOCATION_PROBE is set. e.g. catkin_make -DALLOCATION_PROBE=ON
+ */
+#ifndef ALLOCATION_PROBE
+#define ALLOCATION_PROBE 0
+#endif
+
+namespace AllocationProbe
+{
+
+/*
+ * true if the allocations are being counted
+ */
+bool enabled();
+
+/*
+ * starts counting the allocations made by the calling thread
+ */
+void watchThisThread();
+
+/*
+ * the number of heap allocations the calling thread made since it was first watched. 0 if the probe is not enabled
+ */
+unsigned long count();
+
+}
+
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_ALLOCATIONPROBE_H_ */
@@ -0,0 +1,48 @@
+/*
+ * BriefDescriptor.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "BriefDescriptor.h"
+#include <string.h>
+
+BriefDescriptor::BriefDescriptor()
+{
+	for(int i = 0; i < BRIEF_DESCRIPTOR_WORDS; i++)
+	{
+		words[i] = 0;
+	}
+}
+
+BriefDescriptor::BriefDescriptor(const uchar* data)
+{
+	memcpy(words, data, BRIEF_DESCRIPTOR_BYTES); // memcpy because the row may not be 8 byte aligned
+}
+
+cv::Mat BriefDescriptor::toMat() const
+{
+	cv::Mat desc(1, BRIEF_DESCRIPTOR_BYTES, CV_8U);
+	memcpy(desc.data, words, BRIEF_DESCRIPTOR_BYTES);
+	return desc;
+}
+
+void BriefDescriptor::distances(const BriefDescriptor* a, const BriefDescriptor* b, int* dist, int n)
+{
+	for(int i = 0; i < n; i++)
+	{
+		dist[i] = a[i].distance(b[i]);
+	}
+}
+
+void BriefDescriptor::fromMat(const cv::Mat& descriptors, std::vector<BriefDescriptor>& packed)
+{
+	CV_Assert(descriptors.empty() || (descriptors.type() == CV_8U && descriptors.cols == BRIEF_DESCRIPTOR_BYTES));
+
+	packed.resize(descriptors.rows);
+	for(int i = 0; i < descriptors.rows; i++)
+	{
+		packed[i] = BriefDescriptor(descriptors.ptr<uchar>(i));
+	}
+}
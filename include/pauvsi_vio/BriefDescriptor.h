@@ -0,0 +1,62 @@
+/*
+ * BriefDescriptor.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_BRIEFDESCRIPTOR_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_BRIEFDESCRIPTOR_H_
+
+#include "opencv2/core/core.hpp"
+#include <stdint.h>
+#include <vector>
+
+#define BRIEF_DESCRIPTOR_BYTES 32 // the default size of opencv's BRIEF descriptor
+#define BRIEF_DESCRIPTOR_WORDS (BRIEF_DESCRIPTOR_BYTES / 8)
+
+/*
+ * a 256 bit BRIEF descriptor packed into 4 64 bit words
+ * it lives inside the feature so copying it never touches the heap
+ * the hamming distance is 4 xors and 4 popcounts
+ * on x86 the popcounts are only single instructions with -mpopcnt which the CMakeLists.txt adds
+ */
+struct BriefDescriptor
+{
+	uint64_t words[BRIEF_DESCRIPTOR_WORDS];
+
+	BriefDescriptor();
+
+	/*
+	 * copies BRIEF_DESCRIPTOR_BYTES bytes from data
+	 */
+	BriefDescriptor(const uchar* data);
+
+	/*
+	 * returns the descriptor as a 1 x BRIEF_DESCRIPTOR_BYTES CV_8U row
+	 */
+	cv::Mat toMat() const;
+
+	/*
+	 * number of differing bits
+	 * 0 is a perfect match and 256 is the worst possible match
+	 */
+	inline int distance(const BriefDescriptor& other) const
+	{
+		return __builtin_popcountll(words[0] ^ other.words[0]) + __builtin_popcountll(words[1] ^ other.words[1]) +
+				__builtin_popcountll(words[2] ^ other.words[2]) + __builtin_popcountll(words[3] ^ other.words[3]);
+	}
+
+	/*
+	 * computes the distance between a[i] and b[i] for n pairs
+	 */
+	static void distances(const BriefDescriptor* a, const BriefDescriptor* b, int* dist, int n);
+
+	/*
+	 * packs every row of a CV_8U descriptor matrix with BRIEF_DESCRIPTOR_BYTES columns
+	 */
+	static void fromMat(const cv::Mat& descriptors, std::vector<BriefDescriptor>& packed);
+};
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_BRIEFDESCRIPTOR_H_ */
@@ -0,0 +1,71 @@
+/*
+ * CameraModel.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "CameraModel.h"
+
+CameraModel::CameraModel()
+{
+	infoK.fill(0);
+	version = 0;
+	undistortionMapValid = false;
+	descriptionExtractor = cv::xfeatures2d::BriefDescriptorExtractor::create();
+}
+
+bool CameraModel::update(const sensor_msgs::CameraInfo& info)
+{
+	if(this->isSet() && info.K == infoK && info.D == infoD)
+	{
+		return false;
+	}
+
+	infoK = info.K;
+	infoD = info.D;
+
+	this->K = get3x3FromVector(info.K);
+	this->D = cv::Mat(info.D, true); // copy so the model does not point into the message
+
+	undistortionMapValid = false;
+	version++;
+
+	ROS_DEBUG_STREAM("camera model rebuilt. K = " << this->K);
+	return true;
+}
+
+const UndistortionMap& CameraModel::getUndistortionMap(cv::Size size)
+{
+	ROS_ASSERT(this->isSet());
+	if(!undistortionMapValid || !undistortionMap.hasSize(size))
+	{
+		undistortionMap = UndistortionMap(this->K, this->D, size);
+		undistortionMapValid = true;
+	}
+
+	return undistortionMap;
+}
+
+const ROIMask& CameraModel::getROIMask(cv::Size size, float kill_radius)
+{
+	if(!roiMask.matches(size.width, size.height, kill_radius))
+	{
+		roiMask = ROIMask(size.width, size.height, kill_radius);
+	}
+
+	return roiMask;
+}
+
+cv::Mat CameraModel::get3x3FromVector(const boost::array<double, 9>& vec)
+{
+	cv::Mat mat = cv::Mat(3, 3, CV_32F);
+	for(int i = 0; i < 3; i++)
+	{
+		mat.at<float>(i, 0) = vec.at(3 * i + 0);
+		mat.at<float>(i, 1) = vec.at(3 * i + 1);
+		mat.at<float>(i, 2) = vec.at(3 * i + 2);
+	}
+
+	return mat;
+}
@@ -0,0 +1,89 @@
+/*
+ * CameraModel.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_CAMERAMODEL_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_CAMERAMODEL_H_
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/xfeatures2d.hpp"
+#include <vector>
+#include <boost/array.hpp>
+#include <ros/ros.h>
+#include <sensor_msgs/CameraInfo.h>
+
+#include "UndistortionMap.h"
+#include "ROIMask.h"
+
+/*
+ * the camera shared by every frame
+ * it owns the intrinsics, the undistortion lookup map, the kill radius mask and the BRIEF extractor
+ *
+ * it is only rebuilt when the contents of the camera info change
+ * so the per frame cost of the camera info is one comparison
+ */
+class CameraModel
+{
+public:
+
+	cv::Mat K; // CV_32F 3x3
+	cv::Mat D; // CV_64F fisheye distortion coefficients. owns its data
+
+	CameraModel();
+
+	/*
+	 * updates the model from this camera info
+	 * returns true if it changed and was rebuilt
+	 */
+	bool update(const sensor_msgs::CameraInfo& info);
+
+	bool isSet() const {
+		return !K.empty();
+	}
+
+	/*
+	 * the number of times this model has been rebuilt
+	 */
+	int getVersion() const {
+		return version;
+	}
+
+	/*
+	 * gets the undistortion lookup map for this image size
+	 * it is built the first time it is needed after the model or the image size change
+	 */
+	const UndistortionMap& getUndistortionMap(cv::Size size);
+
+	/*
+	 * gets the region of interest mask for this image size and kill radius
+	 * it is only rebuilt when one of them changes
+	 */
+	const ROIMask& getROIMask(cv::Size size, float kill_radius);
+
+	cv::Ptr<cv::xfeatures2d::BriefDescriptorExtractor> getDescriptionExtractor() const {
+		return descriptionExtractor;
+	}
+
+	static cv::Mat get3x3FromVector(const boost::array<double, 9>& vec);
+
+private:
+
+	boost::array<double, 9> infoK; // the raw camera info this model was built from
+	std::vector<double> infoD;
+
+	int version;
+
+	UndistortionMap undistortionMap;
+	bool undistortionMapValid;
+
+	ROIMask roiMask; // does not depend on the intrinsics so it survives a rebuild
+
+	cv::Ptr<cv::xfeatures2d::BriefDescriptorExtractor> descriptionExtractor;
+};
+
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_CAMERAMODEL_H_ */
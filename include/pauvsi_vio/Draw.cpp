@@ -138,27 +138,29 @@ void VIO::drawKeyFrames()
 
 	//ROS_DEBUG_STREAM("test: " << currentFrame().features.at(0).point->observations.back()->frame);
 
-	for(auto& e : currentFrame().features)
+	const FeatureStore& features = currentFrame().features;
+	for(int i = 0; i < features.size(); i++)
 	{
-		cv::drawMarker(img1, e.original_pxl, cv::Scalar(0, 255, 0), cv::MARKER_SQUARE);
-		//ROS_DEBUG_STREAM("this feature's point info: obs count: " << e.point->observations.size() << " status: " << e.point->status);
+		cv::drawMarker(img1, features.original_pxl[i], cv::Scalar(0, 255, 0), cv::MARKER_SQUARE);
+		Point* pt = features.point[i];
+		//ROS_DEBUG_STREAM("this feature's point info: obs count: " << pt->observations.size() << " status: " << pt->status);
 
-		if(frameBuffer.size() >= FRAME_BUFFER_LENGTH)
+		if(frameBuffer.size() >= FRAME_BUFFER_LENGTH && pt != NULL)
 		{
-			if(e.point->observations.size() > FRAME_BUFFER_LENGTH)
+			if(pt->observations.size() >= FRAME_BUFFER_LENGTH && pt->observations.at(FRAME_BUFFER_LENGTH - 1).valid())
 			{
-				//ROS_DEBUG_STREAM("plotting: " << e.point->observations.at(1)->original_pxl);
-				cv::drawMarker(img2, e.point->observations.at(FRAME_BUFFER_LENGTH - 1)->original_pxl, cv::Scalar(0, 255, 0), cv::MARKER_SQUARE);
-				cv::drawMarker(img1, e.original_pxl, cv::Scalar(255, 255, 0), cv::MARKER_SQUARE);
+				//ROS_DEBUG_STREAM("plotting: " << pt->observations.at(1).getOriginalPixel());
+				cv::drawMarker(img2, pt->observations.at(FRAME_BUFFER_LENGTH - 1).getOriginalPixel(), cv::Scalar(0, 255, 0), cv::MARKER_SQUARE);
+				cv::drawMarker(img1, features.original_pxl[i], cv::Scalar(255, 255, 0), cv::MARKER_SQUARE);
 
-				//ROS_DEBUG_STREAM("frame link: " << e.point->observations.at(0)->frame);
+				//ROS_DEBUG_STREAM("frame link: " << pt->observations.at(0).frame);
 				//ROS_DEBUG_STREAM("test2: " << currentFrame().features.at(0).frame);
-				//ROS_DEBUG_STREAM(e.point->observations.at(0)->original_pxl.x - e.point->observations.at(1)->original_pxl.x);
-				//ROS_ASSERT(e.point->observations.at(0) == &e);
+				//ROS_DEBUG_STREAM(pt->observations.at(0).getOriginalPixel().x - pt->observations.at(1).getOriginalPixel().x);
+				//ROS_ASSERT(pt->observations.at(0).index == i);
 			}
 			else
 			{
-				//ROS_DEBUG_STREAM("frame link outside: " << e.point->observations.at(0)->frame);
+				//ROS_DEBUG_STREAM("frame link outside: " << pt->observations.at(0).frame);
 			}
 		}
 	}
@@ -262,7 +264,7 @@ void VIO::viewMatches(std::vector<VIOFeature2D> ft1, std::vector<VIOFeature2D> f
 	cv::cvtColor(img1, img1, CV_GRAY2BGR);
 	cv::cvtColor(img2, img2, CV_GRAY2BGR);
 
-	cv::Matx33f tK = currentFrame().K;
+	cv::Matx33f tK = currentFrame().camera->K;
 
 	for(int i = 0; i < f1.features.size(); i++)
 	{
@@ -0,0 +1,65 @@
+/*
+ * ErrorStateMeasurement.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_ERRORSTATEMEASUREMENT_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_ERRORSTATEMEASUREMENT_H_
+
+#include <eigen3/Eigen/Core>
+
+#include "VIOState.hpp"
+
+#define ERROR_STATE_MEASUREMENT_MAX_DIM 6 // a full pose
+#define ERROR_STATE_STACKED_MAX_DIM 24 // the most rows solved at once by a stacked update
+#define ERROR_STATE_MIN_RELATIVE_PIVOT 1e-12 // an update is rejected if a pivot of S is smaller than this times the largest
+
+/*
+ * one measurement linearized about the predicted state for the error state ekf
+ *
+ * y is the residual z - h(x), H its jacobian wrt the error state and R its noise covariance
+ * the dimension can be anything up to ERROR_STATE_MEASUREMENT_MAX_DIM
+ * (a pose is 6 and a feature's normalized pixel is 2)
+ * the storage is sized for the largest measurement inline so nothing is allocated
+ */
+class ErrorStateMeasurement
+{
+public:
+
+	typedef Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, ERROR_STATE_MEASUREMENT_MAX_DIM, 1> Residual;
+	typedef Eigen::Matrix<double, Eigen::Dynamic, ERROR_STATE_SIZE, Eigen::ColMajor, ERROR_STATE_MEASUREMENT_MAX_DIM, ERROR_STATE_SIZE> Jacobian;
+	typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor, ERROR_STATE_MEASUREMENT_MAX_DIM, ERROR_STATE_MEASUREMENT_MAX_DIM> Noise;
+
+	Residual y;
+	Jacobian H;
+	Noise R;
+
+	ErrorStateMeasurement()
+	{
+	}
+
+	ErrorStateMeasurement(int dim)
+	{
+		this->resize(dim);
+	}
+
+	/*
+	 * sets the dimension. H and R are zeroed
+	 */
+	void resize(int dim)
+	{
+		y.resize(dim);
+		H.setZero(dim, ERROR_STATE_SIZE);
+		R.setZero(dim, dim);
+	}
+
+	int dim() const {
+		return y.rows();
+	}
+};
+
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_ERRORSTATEMEASUREMENT_H_ */
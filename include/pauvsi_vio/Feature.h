@@ -23,10 +23,12 @@
 
 #include "Frame.h"
 
-class Point;
-
 class Frame;
 
+/*
+ * a feature candidate from the detector
+ * once a feature is added to a frame it is stored in the frame's FeatureStore
+ */
 class Feature{
 
 public:
@@ -37,33 +39,22 @@ public:
 
 	int id;
 
-	cv::Point2f undistort_pxl; // this is the undistorted normal pixel location of this feature
 	cv::Point2f original_pxl; // the original pixel location
 
 	//temporary variables
 	float radius; // the radius of te feature from the center of the image
 	float quality; // this quality is for the ranking process
 
-	Point* point;
-	bool pointLost;
-
-	cv::Mat description;
-
 	//flags
-	bool described; // is this feature described
-	bool undistorted; // is this feature undistorted
 	bool set; // says whether the feature was set
 
 
 	Feature();
 
-	Feature(Frame* _frame, cv::Point2f px, Point* pt, int id = -1);
-
-	void undistort(cv::Mat K, cv::Mat D);
-
-	Eigen::Vector3d getDirectionVector();
-
-	Eigen::Vector2d getUndistortedMeasurement();
+	/*
+	 * lightweight constructor which only sets the pixel and id
+	 */
+	Feature(Frame* _frame, cv::Point2f px, int id);
 
 
 };
@@ -0,0 +1,166 @@
+/*
+ * FeatureGrid.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "FeatureGrid.h"
+#include "Feature.h"
+
+FeatureGrid::FeatureGrid()
+{
+	cellSize = 1;
+	cols = 0;
+	rows = 0;
+}
+
+/*
+ * buckets the features by their original pixel
+ * cell_size should be the distance which will be queried
+ * width, height: the size of the image the features come from
+ */
+void FeatureGrid::build(const std::vector<Feature>& feats, int width, int height, int cell_size)
+{
+	std::vector<cv::Point2f> px(feats.size());
+	for(int i = 0; i < feats.size(); i++)
+	{
+		px[i] = feats[i].original_pxl;
+	}
+
+	this->build(px, width, height, cell_size);
+}
+
+/*
+ * buckets the pixels
+ * the index of each pixel is the index returned by getNeighbors
+ */
+void FeatureGrid::build(const std::vector<cv::Point2f>& px, int width, int height, int cell_size)
+{
+	this->cellSize = std::max(cell_size, 1);
+	this->cols = width / this->cellSize + 1;
+	this->rows = height / this->cellSize + 1;
+
+	cellStart.assign(this->numCells() + 1, 0);
+	cellMembers.resize(px.size());
+	pixels.resize(px.size());
+
+	std::vector<int> cellOf(px.size());
+
+	// count the pixels in each cell
+	for(int i = 0; i < px.size(); i++)
+	{
+		cellOf.at(i) = cellRow(px.at(i).y) * cols + cellCol(px.at(i).x);
+		cellStart.at(cellOf.at(i) + 1)++;
+	}
+
+	// prefix sum to get the start of each cell
+	for(int c = 0; c < this->numCells(); c++)
+	{
+		cellStart.at(c + 1) += cellStart.at(c);
+	}
+
+	// place each pixel in its cell
+	std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+	for(int i = 0; i < px.size(); i++)
+	{
+		int slot = fill.at(cellOf.at(i))++;
+		cellMembers.at(slot) = i;
+		pixels.at(slot) = px.at(i);
+	}
+}
+
+/*
+ * returns true if any feature in the grid is closer than dist (manhattan) to px
+ * dist must be <= the cell size
+ */
+bool FeatureGrid::hasNeighbor(cv::Point2f px, float dist) const
+{
+	ROS_ASSERT(dist <= cellSize);
+	if(pixels.empty())
+	{
+		return false;
+	}
+
+	int c0 = cellCol(px.x);
+	int r0 = cellRow(px.y);
+
+	for(int r = std::max(r0 - 1, 0); r <= std::min(r0 + 1, rows - 1); r++)
+	{
+		// the cells in a row are contiguous so the three cells are one range
+		int first = cellStart.at(r * cols + std::max(c0 - 1, 0));
+		int last = cellStart.at(r * cols + std::min(c0 + 1, cols - 1) + 1);
+		for(int i = first; i < last; i++)
+		{
+			if(std::abs(pixels[i].x - px.x) + std::abs(pixels[i].y - px.y) < dist)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/*
+ * fills neighbors with the indexes (into the vector the grid was built from)
+ * of all features closer than dist (manhattan) to px
+ * dist must be <= the cell size
+ */
+void FeatureGrid::getNeighbors(cv::Point2f px, float dist, std::vector<int>& neighbors) const
+{
+	ROS_ASSERT(dist <= cellSize);
+	neighbors.clear();
+	if(pixels.empty())
+	{
+		return;
+	}
+
+	int c0 = cellCol(px.x);
+	int r0 = cellRow(px.y);
+
+	for(int r = std::max(r0 - 1, 0); r <= std::min(r0 + 1, rows - 1); r++)
+	{
+		int first = cellStart.at(r * cols + std::max(c0 - 1, 0));
+		int last = cellStart.at(r * cols + std::min(c0 + 1, cols - 1) + 1);
+		for(int i = first; i < last; i++)
+		{
+			if(std::abs(pixels[i].x - px.x) + std::abs(pixels[i].y - px.y) < dist)
+			{
+				neighbors.push_back(cellMembers[i]);
+			}
+		}
+	}
+}
+
+/*
+ * gets the pixel bounds of a cell
+ */
+cv::Rect FeatureGrid::getCellRect(int cell) const
+{
+	return cv::Rect((cell % cols) * cellSize, (cell / cols) * cellSize, cellSize, cellSize);
+}
+
+/*
+ * gets the indexes of the features in a cell
+ * the indexes are stored in [begin, end)
+ */
+void FeatureGrid::getCell(int cell, const int*& begin, const int*& end) const
+{
+	begin = cellMembers.data() + cellStart.at(cell);
+	end = cellMembers.data() + cellStart.at(cell + 1);
+}
+
+/*
+ * pixels outside of the image are clamped to the border cells.
+ * this only ever moves a feature closer to the query's cell so no neighbor is missed
+ */
+int FeatureGrid::cellCol(float x) const
+{
+	return std::min(std::max((int)floor(x / cellSize), 0), cols - 1);
+}
+
+int FeatureGrid::cellRow(float y) const
+{
+	return std::min(std::max((int)floor(y / cellSize), 0), rows - 1);
+}
@@ -0,0 +1,93 @@
+/*
+ * FeatureGrid.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_FEATUREGRID_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_FEATUREGRID_H_
+
+#include "opencv2/core/core.hpp"
+#include <vector>
+
+class Feature;
+
+/*
+ * a uniform grid over the image which buckets features by pixel location
+ * the cell size is the search distance so any neighbor closer than it
+ * is always in the 3x3 block of cells around the query
+ *
+ * the buckets are stored contiguously (counting sort) so building the grid
+ * costs one pass over the features and no per cell allocations
+ */
+class FeatureGrid
+{
+public:
+
+	FeatureGrid();
+
+	/*
+	 * buckets the features by their original pixel
+	 * cell_size should be the distance which will be queried
+	 * width, height: the size of the image the features come from
+	 */
+	void build(const std::vector<Feature>& feats, int width, int height, int cell_size);
+
+	/*
+	 * buckets the pixels
+	 * the index of each pixel is the index returned by getNeighbors
+	 */
+	void build(const std::vector<cv::Point2f>& px, int width, int height, int cell_size);
+
+	/*
+	 * returns true if any feature in the grid is closer than dist (manhattan) to px
+	 * dist must be <= the cell size
+	 */
+	bool hasNeighbor(cv::Point2f px, float dist) const;
+
+	/*
+	 * fills neighbors with the indexes (into the vector the grid was built from)
+	 * of all features closer than dist (manhattan) to px
+	 * dist must be <= the cell size
+	 */
+	void getNeighbors(cv::Point2f px, float dist, std::vector<int>& neighbors) const;
+
+	/*
+	 * gets the pixel bounds of a cell
+	 */
+	cv::Rect getCellRect(int cell) const;
+
+	/*
+	 * gets the indexes of the features in a cell
+	 * the indexes are stored in [begin, end)
+	 */
+	void getCell(int cell, const int*& begin, const int*& end) const;
+
+	int getCellSize() const {
+		return cellSize;
+	}
+
+	int numCells() const {
+		return cols * rows;
+	}
+
+	bool empty() const {
+		return pixels.empty();
+	}
+
+private:
+
+	int cellSize;
+	int cols;
+	int rows;
+
+	std::vector<int> cellStart; // the first index in cellMembers of each cell. has numCells() + 1 entries
+	std::vector<int> cellMembers; // feature indexes sorted by cell
+	std::vector<cv::Point2f> pixels; // the pixel of each feature sorted by cell so queries never touch the Feature objects
+
+	int cellCol(float x) const;
+	int cellRow(float y) const;
+};
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_FEATUREGRID_H_ */
@@ -0,0 +1,126 @@
+/*
+ * FeatureStore.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "FeatureStore.h"
+#include "Frame.h"
+
+int FeatureStore::add(cv::Point2f px, int _id, Point* pt)
+{
+	original_pxl.push_back(px);
+	undistort_pxl.push_back(cv::Point2f(0, 0));
+	id.push_back(_id);
+	point.push_back(pt);
+	description.push_back(BriefDescriptor());
+	undistorted.push_back(false);
+	described.push_back(false);
+	pointLost.push_back(false);
+
+	return original_pxl.size() - 1;
+}
+
+void FeatureStore::reserve(int n)
+{
+	original_pxl.reserve(n);
+	undistort_pxl.reserve(n);
+	id.reserve(n);
+	point.reserve(n);
+	description.reserve(n);
+	undistorted.reserve(n);
+	described.reserve(n);
+	pointLost.reserve(n);
+}
+
+void FeatureStore::clear()
+{
+	original_pxl.clear();
+	undistort_pxl.clear();
+	id.clear();
+	point.clear();
+	description.clear();
+	undistorted.clear();
+	described.clear();
+	pointLost.clear();
+}
+
+Eigen::Vector2d FeatureStore::getUndistortedMeasurement(int i) const
+{
+	ROS_ASSERT(undistorted.at(i));
+	return Eigen::Vector2d(undistort_pxl[i].x, undistort_pxl[i].y);
+}
+
+Eigen::Vector3d FeatureStore::getDirectionVector(int i) const
+{
+	ROS_ASSERT(undistorted.at(i));
+	return Eigen::Vector3d(undistort_pxl[i].x, undistort_pxl[i].y, 1.0);
+}
+
+FeatureRef::FeatureRef()
+{
+	frame = NULL;
+	generation = 0;
+	index = -1;
+}
+
+FeatureRef::FeatureRef(Frame* _frame, int _index)
+{
+	frame = _frame;
+	generation = _frame->generation;
+	index = _index;
+}
+
+bool FeatureRef::valid() const
+{
+	return frame != NULL && frame->generation == generation;
+}
+
+const cv::Point2f& FeatureRef::getOriginalPixel() const
+{
+	ROS_ASSERT(this->valid());
+	return frame->features.original_pxl.at(index);
+}
+
+const cv::Point2f& FeatureRef::getUndistortedPixel() const
+{
+	ROS_ASSERT(this->valid());
+	ROS_ASSERT(frame->features.undistorted.at(index));
+	return frame->features.undistort_pxl.at(index);
+}
+
+Eigen::Vector2d FeatureRef::getUndistortedMeasurement() const
+{
+	ROS_ASSERT(this->valid());
+	return frame->features.getUndistortedMeasurement(index);
+}
+
+Eigen::Vector3d FeatureRef::getDirectionVector() const
+{
+	ROS_ASSERT(this->valid());
+	return frame->features.getDirectionVector(index);
+}
+
+bool FeatureRef::isDescribed() const
+{
+	ROS_ASSERT(this->valid());
+	return frame->features.described.at(index);
+}
+
+const BriefDescriptor& FeatureRef::getDescription() const
+{
+	ROS_ASSERT(this->valid());
+	return frame->features.description.at(index);
+}
+
+void FeatureRef::setPointLost() const
+{
+	if(!this->valid())
+	{
+		return;
+	}
+
+	frame->features.point.at(index) = NULL;
+	frame->features.pointLost.at(index) = true;
+}
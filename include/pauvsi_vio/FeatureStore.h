@@ -0,0 +1,113 @@
+/*
+ * FeatureStore.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_FEATURESTORE_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_FEATURESTORE_H_
+
+#include "opencv2/core/core.hpp"
+#include <eigen3/Eigen/Geometry>
+#include <vector>
+#include <ros/ros.h>
+
+#include "BriefDescriptor.h"
+
+class Point;
+
+class Frame;
+
+/*
+ * the features of a frame stored as parallel arrays
+ * index i of every array belongs to feature i
+ *
+ * features are only ever appended so an index stays valid for the whole life of the frame
+ * tracks which should not continue are culled before they are added to the next frame
+ */
+class FeatureStore
+{
+public:
+
+	std::vector<cv::Point2f> original_pxl; // the original pixel location
+	std::vector<cv::Point2f> undistort_pxl; // the undistorted normal pixel location. only valid if undistorted
+	std::vector<int> id;
+	std::vector<Point*> point; // the 3d point each feature observes. NULL if it has none or it was lost
+	std::vector<BriefDescriptor> description; // only valid if described
+
+	//flags
+	std::vector<uchar> undistorted;
+	std::vector<uchar> described;
+	std::vector<uchar> pointLost;
+
+	/*
+	 * appends a feature which is neither undistorted nor described
+	 * returns its index
+	 */
+	int add(cv::Point2f px, int _id, Point* pt = NULL);
+
+	int size() const {
+		return original_pxl.size();
+	}
+
+	bool empty() const {
+		return original_pxl.empty();
+	}
+
+	void reserve(int n);
+
+	void clear();
+
+	/*
+	 * the undistorted measurement [u, v] of feature i
+	 */
+	Eigen::Vector2d getUndistortedMeasurement(int i) const;
+
+	/*
+	 * the direction vector [u, v, 1] of feature i
+	 */
+	Eigen::Vector3d getDirectionVector(int i) const;
+};
+
+/*
+ * a stable handle to a feature: the frame it was observed in and its index in that frame
+ * features are never moved so this stays valid until the frame's slot is reused
+ * the frame's generation is remembered so a handle into a reused frame can be detected
+ */
+struct FeatureRef
+{
+	Frame* frame;
+	unsigned int generation;
+	int index;
+
+	FeatureRef();
+
+	FeatureRef(Frame* _frame, int _index);
+
+	/*
+	 * true if the frame still holds the image this feature was observed in
+	 */
+	bool valid() const;
+
+	const cv::Point2f& getOriginalPixel() const;
+
+	const cv::Point2f& getUndistortedPixel() const;
+
+	Eigen::Vector2d getUndistortedMeasurement() const;
+
+	Eigen::Vector3d getDirectionVector() const;
+
+	bool isDescribed() const;
+
+	const BriefDescriptor& getDescription() const;
+
+	/*
+	 * unlinks the feature from its point and marks the point as lost
+	 * does nothing if the handle is no longer valid
+	 */
+	void setPointLost() const;
+};
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_FEATURESTORE_H_ */
@@ -9,7 +9,11 @@
 
 FeatureTracker::FeatureTracker()
 {
-
+	this->PREDICTED_FLOW_PYRAMID_LEVELS = DEFAULT_PREDICTED_FLOW_PYRAMID_LEVELS;
+	this->PREDICTED_FLOW_MAX_ITERATIONS = DEFAULT_PREDICTED_FLOW_MAX_ITERATIONS;
+	this->FORWARD_BACKWARD_CHECK = false;
+	this->FORWARD_BACKWARD_THRESHOLD = DEFAULT_FORWARD_BACKWARD_THRESHOLD;
+	this->KILL_RADIUS = -1;
 }
 
 void FeatureTracker::setParams(int fst, float mev, bool kbd, int nf, int mnfd)
@@ -21,6 +25,113 @@ void FeatureTracker::setParams(int fst, float mev, bool kbd, int nf, int mnfd)
 	this->MIN_NEW_FEATURE_DISTANCE = mnfd;
 }
 
+void FeatureTracker::setKillRadius(float killRadius)
+{
+	this->KILL_RADIUS = killRadius;
+}
+
+void FeatureTracker::setPredictedFlowParams(int levels, int iterations)
+{
+	this->PREDICTED_FLOW_PYRAMID_LEVELS = levels;
+	this->PREDICTED_FLOW_MAX_ITERATIONS = iterations;
+}
+
+void FeatureTracker::setForwardBackwardParams(bool check, double threshold)
+{
+	this->FORWARD_BACKWARD_CHECK = check;
+	this->FORWARD_BACKWARD_THRESHOLD = threshold;
+}
+
+/*
+ * tracks chunks of features with lucas kanade in parallel
+ * if the forward-backward check is on each chunk is flowed back to the old frame right after it is flowed forward
+ * status is 1 if tracked, 0 if lucas kanade lost it and 2 if it failed the forward-backward check
+ *
+ * every buffer is allocated by the caller and each chunk wraps its part of them in cv::Mat headers
+ * so the chunks do not allocate or copy
+ */
+class FlowChunkInvoker : public cv::ParallelLoopBody
+{
+public:
+	FlowChunkInvoker(const std::vector<cv::Mat>& _oldPyramid, const std::vector<cv::Mat>& _newPyramid,
+			const cv::Point2f* _oldPoints, cv::Point2f* _newPoints, uchar* _status, float* _error, cv::Point2f* _backPoints, uchar* _backStatus, int _n,
+			int _chunkSize, cv::Size _winSize, int _levels, int _iterations, int _flags, float _minEigen, bool _fbCheck, double _fbThreshold) :
+				oldPyramid(_oldPyramid), newPyramid(_newPyramid), oldPoints(_oldPoints), newPoints(_newPoints), status(_status),
+				error(_error), backPoints(_backPoints), backStatus(_backStatus), n(_n),
+				chunkSize(_chunkSize), winSize(_winSize), levels(_levels), iterations(_iterations), flags(_flags), minEigen(_minEigen),
+				fbCheck(_fbCheck), fbThreshold(_fbThreshold)
+	{
+	}
+
+	virtual void operator()(const cv::Range& range) const
+	{
+		cv::TermCriteria criteria(cv::TermCriteria::COUNT+cv::TermCriteria::EPS, iterations, 0.01);
+
+		for(int c = range.start; c < range.end; c++)
+		{
+			int begin = c * chunkSize;
+			int end = std::min(begin + chunkSize, n);
+			if(begin >= end)
+			{
+				continue;
+			}
+			int count = end - begin;
+
+			// each chunk only reads and writes its own part of the buffers
+			cv::Mat chunkOld(count, 1, CV_32FC2, (void*)(oldPoints + begin));
+			cv::Mat chunkNew(count, 1, CV_32FC2, newPoints + begin); // the initial flow if it is used
+			cv::Mat chunkStatus(count, 1, CV_8U, status + begin);
+			cv::Mat chunkError(count, 1, CV_32F, error + begin);
+
+			cv::calcOpticalFlowPyrLK(oldPyramid, newPyramid, chunkOld, chunkNew, chunkStatus, chunkError, winSize, levels,
+					criteria, flags, minEigen);
+
+			if(!fbCheck)
+			{
+				continue;
+			}
+
+			// start the backward search at the original position
+			std::copy(oldPoints + begin, oldPoints + end, backPoints + begin);
+			cv::Mat chunkBack(count, 1, CV_32FC2, backPoints + begin);
+			cv::Mat chunkBackStatus(count, 1, CV_8U, backStatus + begin);
+			cv::calcOpticalFlowPyrLK(newPyramid, oldPyramid, chunkNew, chunkBack, chunkBackStatus, chunkError, winSize, levels,
+					criteria, cv::OPTFLOW_USE_INITIAL_FLOW, minEigen);
+
+			for(int i = begin; i < end; i++)
+			{
+				if(status[i] == 1)
+				{
+					cv::Point2f d = backPoints[i] - oldPoints[i];
+					if(backStatus[i] != 1 || d.x * d.x + d.y * d.y > fbThreshold * fbThreshold)
+					{
+						status[i] = 2;
+					}
+				}
+			}
+		}
+	}
+
+private:
+	const std::vector<cv::Mat>& oldPyramid;
+	const std::vector<cv::Mat>& newPyramid;
+	const cv::Point2f* oldPoints;
+	cv::Point2f* newPoints;
+	uchar* status;
+	float* error;
+	cv::Point2f* backPoints;
+	uchar* backStatus;
+	int n;
+	int chunkSize;
+	cv::Size winSize;
+	int levels;
+	int iterations;
+	int flags;
+	float minEigen;
+	bool fbCheck;
+	double fbThreshold;
+};
+
 /*
  * This will match feature descriptors between two images
  *
@@ -45,15 +156,22 @@ std::vector<cv::DMatch> FeatureTracker::matchFeaturesWithFlann(cv::Mat query, cv
  * This function does not require a prediction
  * This will set the feature vector within the new frame with the
  * flowed points
+ *
+ * if cameraRotation is given the search for each feature starts at its position predicted from
+ * the rotation and the reduced pyramid levels and iterations are used
+ * cameraRotation rotates vectors in the new camera frame into the old camera frame
  */
-bool FeatureTracker::flowFeaturesToNewFrame(Frame& oldFrame, Frame& newFrame){
+bool FeatureTracker::flowFeaturesToNewFrame(Frame& oldFrame, Frame& newFrame, const Eigen::Matrix3d* cameraRotation){
 
-	std::vector<cv::Point2f> oldPoints = oldFrame.getPoint2fVectorFromFeatures();
+	// the old pixels are already contiguous in the old frame's feature store
+	const std::vector<cv::Point2f>& oldPoints = oldFrame.features.original_pxl;
 	//ROS_DEBUG_STREAM_ONCE("got " << oldPoints.size() << " old point2fs from the oldframe which has " << oldFrame.features.size() << " features");
-	std::vector<cv::Point2f> newPoints;
 
-	std::vector<uchar> status; // status vector for each point
-	cv::Mat error; // error vector for each point
+	// all scratch buffers of the flow come from the frame arena
+	FrameArena& arena = FrameArena::get();
+	ArenaVector<cv::Point2f> newPoints(arena);
+
+	ArenaVector<uchar> status(arena); // status vector for each point
 
 	//ROS_DEBUG_ONCE("running lucas kande optical flow algorithm");
 	/*
@@ -63,92 +181,182 @@ bool FeatureTracker::flowFeaturesToNewFrame(Frame& oldFrame, Frame& newFrame){
 	 * it will kill bad features
 	 */
 	ros::Time t_start = ros::Time::now();
-	cv::calcOpticalFlowPyrLK(oldFrame.image, newFrame.image, oldPoints, newPoints, status, error, cv::Size(21, 21), 3,
-			cv::TermCriteria(cv::TermCriteria::COUNT+cv::TermCriteria::EPS, 30, 0.01), 0, this->MIN_EIGEN_VALUE);
+	cv::Size winSize = cv::Size(OPTICAL_FLOW_WINDOW_SIZE, OPTICAL_FLOW_WINDOW_SIZE);
+
+	// the old frame's pyramid was already built when it was the new frame so only the new one is built here
+	const std::vector<cv::Mat>& oldPyramid = oldFrame.getPyramid(winSize, OPTICAL_FLOW_PYRAMID_LEVELS);
+	const std::vector<cv::Mat>& newPyramid = newFrame.getPyramid(winSize, OPTICAL_FLOW_PYRAMID_LEVELS);
+
+	int levels = OPTICAL_FLOW_PYRAMID_LEVELS;
+	int iterations = OPTICAL_FLOW_MAX_ITERATIONS;
+	int flags = 0;
+
+	// start each search at the position predicted from the gyro
+	// the prediction is close so the search needs less levels and iterations
+	if(cameraRotation != NULL)
+	{
+		this->predictFeaturePositions(oldFrame, newFrame, *cameraRotation, newPoints);
+		levels = std::min(this->PREDICTED_FLOW_PYRAMID_LEVELS, OPTICAL_FLOW_PYRAMID_LEVELS); // the cached pyramid has OPTICAL_FLOW_PYRAMID_LEVELS
+		iterations = this->PREDICTED_FLOW_MAX_ITERATIONS;
+		flags = cv::OPTFLOW_USE_INITIAL_FLOW;
+	}
+
+	// split the features into about one chunk per thread
+	int n = oldPoints.size();
+	newPoints.resize(n);
+	status.resize(n);
+	float* error = arena.allocate<float>(n);
+	cv::Point2f* backPoints = arena.allocate<cv::Point2f>(n);
+	uchar* backStatus = arena.allocate<uchar>(n);
+	int nChunks = std::max(1, std::min(cv::getNumThreads(), n / MIN_FLOW_CHUNK_SIZE));
+	int chunkSize = (n + nChunks - 1) / nChunks;
+
+	if(n > 0)
+	{
+		cv::parallel_for_(cv::Range(0, nChunks), FlowChunkInvoker(oldPyramid, newPyramid, oldPoints.data(), newPoints.data(), status.data(),
+				error, backPoints, backStatus, n,
+				chunkSize, winSize, levels, iterations, flags, this->MIN_EIGEN_VALUE, this->FORWARD_BACKWARD_CHECK, this->FORWARD_BACKWARD_THRESHOLD));
+	}
 	ROS_DEBUG_STREAM("ran flow in :" << 1000 * (ros::Time::now().toSec() - t_start.toSec()));
 
+	this->lastFlowStats = FlowStats();
+
 	//ROS_DEBUG_STREAM_ONCE("ran optical flow and got " << newPoints.size() << " points out");
 
+	// cull the tracks which left the region of interest before anything is added to the new frame
+	if(this->KILL_RADIUS > 0)
+	{
+		const ROIMask& roi = newFrame.getROIMask(this->KILL_RADIUS);
+		for(int i = 0; i < newPoints.size(); i++)
+		{
+			if(status.at(i) == 1 && !roi.contains(newPoints.at(i)))
+			{
+				status.at(i) = 3;
+			}
+		}
+	}
+
+	//if user wants to kill by similarity
+	ArenaVector<BriefDescriptor> newDescriptions(arena);
+	ArenaVector<uchar> newDescribed(arena);
+	if(KILL_BY_DISSIMILARITY)
+	{
+		//ROS_DEBUG("killing by similarity");
+		this->checkFeatureConsistency(oldFrame, newFrame, newPoints, status, newDescriptions, newDescribed, this->FEATURE_SIMILARITY_THRESHOLD);
+	}
+
+	// only the surviving tracks are added so the new frame's features never have to move
 	int lostFeatures = 0;
+	int firstNewFeature = newFrame.features.size();
+	newFrame.features.reserve(firstNewFeature + newPoints.size());
 	//next add these features into the new Frame
 	for (int i = 0; i < newPoints.size(); i++)
 	{
 		//check if the point was able to flow
 		if(status.at(i) == 1)
 		{
-			ROS_DEBUG("creating new feature from flowed feat");
-			// the id number is not that important because it will be handled by the frame
-			Feature feat(&newFrame, newPoints.at(i), oldFrame.features.at(i).point); // create a matched feature with id = -1
-			ROS_DEBUG_STREAM("frame index: " << feat.frame);
-			//ROS_ASSERT(oldFrame.features.at(i).point == feat.point);
-			//ROS_ASSERT(oldFrame.features.at(i).point->observations.size() == feat.point->observations.size());
-
-			//if the previous feature was described
-			if(oldFrame.features.at(i).described)
+			// the new feature is linked to the old feature's point once all features are added
+			int index = newFrame.addFeature(newPoints.at(i), oldFrame.features.point.at(i));
+
+			if(KILL_BY_DISSIMILARITY && newDescribed.at(i))
 			{
-				//ROS_DEBUG("transferring feature description");
-				feat.description = (oldFrame.features.at(i).description); // transfer previous description to new feature
-				//ROS_DEBUG_STREAM_THROTTLE(0, feat.getFeatureDescription());
+				newFrame.features.description.at(index) = newDescriptions.at(i);
+				newFrame.features.described.at(index) = true;
+			}
+		}
+		else
+		{
+			lostFeatures++;
+			if(status.at(i) == 2)
+			{
+				this->lastFlowStats.lostByForwardBackward++;
+			}
+			else if(status.at(i) == 3)
+			{
+				this->lastFlowStats.lostByKillRadius++;
+			}
+			else if(status.at(i) == 4)
+			{
+				this->lastFlowStats.lostByDissimilarity++;
+			}
+			else
+			{
+				this->lastFlowStats.lostByStatus++;
 			}
 
-			//ROS_DEBUG_STREAM("old: " << oldFrame.features.at(i).getMatchedIDDeque().size() << " new: " << feat.getMatchedIDDeque().size());
+			if(oldFrame.features.point.at(i) != NULL)
+			{
+				ROS_DEBUG("deleting point");
+				oldFrame.features.point.at(i)->safelyDelete();
+			}
+		}
+	}
 
-			//find the cause of this bug and remove this hacky fix
-			// i have to reset the last observations pointer for some reason
-			//feat.point->observations.at(1) = &oldFrame.features.at(i);
-			newFrame.addFeature(feat); // add this feature to the new frame
-			newFrame.features.back().point->observations.at(0) = &newFrame.features.back(); // i must refer the feature
-			ROS_DEBUG("finished adding feature");
+	newFrame.linkFeatures(firstNewFeature);
 
-			/*ROS_ASSERT(&newFrame.features.at(newFrame.features.size() - 1) == &newFrame.features.back());
+	ROS_DEBUG("at end of optical flow");
+	ROS_DEBUG_STREAM_COND(lostFeatures, "optical flow lost " << lostFeatures <<  " feature(s)");
 
-			//assert to check that everything checks out
-			ROS_ASSERT(*(newFrame.features.back().frame) == newFrame);
-			ROS_ASSERT(*(newFrame.features.back().point->observations.at(0)->frame) == newFrame);
-			ROS_DEBUG_STREAM("oldFrame feature: " << &oldFrame.features.at(i) << " point feature pointer: " << newFrame.features.back().point->observations.at(1));
-			ROS_DEBUG_STREAM((newFrame.features.back().point->observations.at(1)->frame));
-			ROS_DEBUG_STREAM("old frame address: " << &oldFrame);
-			ROS_DEBUG_STREAM((newFrame.features.back().point->observations.at(0)->frame));
-			ROS_DEBUG_STREAM("new frame address: " << &newFrame);
+	this->lastFlowStats.flowed = newFrame.features.size() - firstNewFeature;
+	ROS_DEBUG_STREAM("flowed " << lastFlowStats.flowed << " features. lost by status: " << lastFlowStats.lostByStatus
+			<< " forward-backward: " << lastFlowStats.lostByForwardBackward << " kill radius: " << lastFlowStats.lostByKillRadius
+			<< " dissimilarity: " << lastFlowStats.lostByDissimilarity);
+
+	return true;
+}
 
-			if(newFrame.features.back().point->observations.size() > 2)
-			{
-				ROS_DEBUG_STREAM("### third frame pointer " << newFrame.features.back().point->observations.at(2)->frame);
-			}
 
-			ROS_ASSERT(*(newFrame.features.back().point->observations.at(1)->frame) == oldFrame);
 
+/*
+ * predicts where each of the old frame's features will be in the new frame if the camera only rotates
+ * each undistorted feature is rotated into the new camera frame and projected back through the fisheye model
+ * cameraRotation rotates vectors in the new camera frame into the old camera frame
+ * features which rotate behind the camera are predicted to stay where they were
+ */
+void FeatureTracker::predictFeaturePositions(Frame& oldFrame, Frame& newFrame, const Eigen::Matrix3d& cameraRotation, ArenaVector<cv::Point2f>& predicted)
+{
+	Eigen::Matrix3d R = cameraRotation.transpose(); // old camera frame -> new camera frame
+
+	oldFrame.undistortFeatures(); // only undistorts the features which are not undistorted yet
+	const std::vector<cv::Point2f>& undistorted = oldFrame.features.undistort_pxl;
 
-			//set the forward match for the old feature
-			oldFrame.features.at(i).forwardMatched = true;
-			oldFrame.features.at(i).forwardMatchIndex = newFrame.features.size() - 1;
-			oldFrame.features.at(i).forwardMatchID = newFrame.features.at(newFrame.features.size() - 1).getFeatureID();*/
+	int n = undistorted.size();
+	predicted.resize(n);
+	if(n == 0)
+	{
+		return;
+	}
+
+	cv::Point2f* rotated = FrameArena::get().allocate<cv::Point2f>(n);
+	uchar* behind = FrameArena::get().allocate<uchar>(n);
+	for(int i = 0; i < n; i++)
+	{
+		Eigen::Vector3d dir = R * Eigen::Vector3d(undistorted[i].x, undistorted[i].y, 1.0);
+		behind[i] = dir(2) <= 1e-6;
+		if(behind[i])
+		{
+			rotated[i] = undistorted[i]; // replaced below
 		}
 		else
 		{
-			lostFeatures++;
-			//oldFrame.features.at(i).point->setStatus(Point::TRACKING_LOST); // update the status of the point to lost this will then be cleaned up
-			ROS_ASSERT(oldFrame.features.at(i).point != NULL);
-			ROS_DEBUG("deleting point");
-			oldFrame.features.at(i).point->safelyDelete();
-			ROS_DEBUG("finished deleting point");
+			rotated[i] = cv::Point2f(dir(0) / dir(2), dir(1) / dir(2));
 		}
 	}
-	ROS_DEBUG("at end of optical flow");
-	ROS_DEBUG_STREAM_COND(lostFeatures, "optical flow lost " << lostFeatures <<  " feature(s)");
 
-	//if user wants to kill by similarity
-	if(KILL_BY_DISSIMILARITY)
+	// the output is written straight into predicted
+	cv::Mat in(n, 1, CV_32FC2, rotated);
+	cv::Mat out(n, 1, CV_32FC2, predicted.data());
+	cv::fisheye::distortPoints(in, out, newFrame.camera->K, newFrame.camera->D);
+
+	for(int i = 0; i < n; i++)
 	{
-		//ROS_DEBUG("killing by similarity");
-		this->checkFeatureConsistency(newFrame, this->FEATURE_SIMILARITY_THRESHOLD);
+		if(behind[i])
+		{
+			predicted[i] = oldFrame.features.original_pxl[i];
+		}
 	}
-
-	return true;
 }
 
-
-
 /*
  * gets corresponding points between the two frames as two vectors of point2f
  * checks if index and id match for saftey
@@ -174,49 +382,76 @@ void FeatureTracker::getCorrespondingPointsFromFrames(Frame lastFrame, Frame cur
 
 /*
  * checks to see if current descriptor is similar to actual feature
- * if similarity is bellow threshold, feature is kept and descriptor is updated
- * otherwise feature is removed from feature vector
+ * every track which is still alive (status 1) is described at its new position in one batch
+ * and compared to the description of its feature in the old frame
+ * if the distance is above the threshold its status is set to 4
+ * tracks whose old feature was not described are kept
+ *
+ * descriptions and described are filled for every track so the new descriptions can be
+ * stored with the new features and never have to be computed again
  */
-void FeatureTracker::checkFeatureConsistency(Frame& checkFrame, int killThreshold ){
-	cv::Mat newDescription = checkFrame.describeFeaturesWithBRIEF(checkFrame.image, checkFrame.features);
-
-	std::vector<Feature> tempFeatures;
-
-	for (int i = 0; i < checkFrame.features.size(); i++){
-
-		if(!checkFrame.features.at(i).described)
-			break;
-
-		cv::Mat row = newDescription.row(i);
-
-		//ROS_DEBUG_STREAM_ONCE("got feature description " << row);
+void FeatureTracker::checkFeatureConsistency(Frame& oldFrame, Frame& newFrame, const ArenaVector<cv::Point2f>& newPoints, ArenaVector<uchar>& status,
+		ArenaVector<BriefDescriptor>& descriptions, ArenaVector<uchar>& described, int killThreshold){
+	FrameArena& arena = FrameArena::get();
+	int n = newPoints.size();
+
+	// gather the alive tracks
+	int* indexes = arena.allocate<int>(n);
+	cv::Point2f* pixels = arena.allocate<cv::Point2f>(n);
+	int alive = 0;
+	for (int i = 0; i < n; i++)
+	{
+		if(status[i] == 1)
+		{
+			indexes[alive] = i;
+			pixels[alive] = newPoints[i];
+			alive++;
+		}
+	}
 
-		int x = checkFrame.compareDescriptors(row, checkFrame.features.at(i).description);
-		//int x = checkFrame.compareDescriptors(row, row);
+	BriefDescriptor* packed = arena.allocate<BriefDescriptor>(alive);
+	uchar* ok = arena.allocate<uchar>(alive);
+	newFrame.describePixels(pixels, alive, packed, ok);
 
-		if (x <= killThreshold){
+	descriptions.assign(n, BriefDescriptor());
+	described.assign(n, false);
 
-			//ROS_DEBUG_STREAM("features match " << i <<" : "<<checkFrame.features.size()<<" : "<< newDescription.rows <<" : " << x);
-			//ROS_DEBUG_STREAM("i+1: "<< checkFrame.features.at(i+1).getFeatureDescription()<<":"<<checkFrame.features.at(i+1).isFeatureDescribed());
-			//ROS_DEBUG_STREAM("description size " << checkFrame.features.at(i).getFeatureDescription().cols);
+	// gather the pairs which can be compared
+	int* compared = arena.allocate<int>(alive);
+	BriefDescriptor* current = arena.allocate<BriefDescriptor>(alive);
+	BriefDescriptor* previous = arena.allocate<BriefDescriptor>(alive);
+	int nCompared = 0;
+	for(int j = 0; j < alive; j++)
+	{
+		int i = indexes[j];
+		if(!ok[j])
+		{
+			continue;
+		}
 
-			checkFrame.features.at(i).description = row;
+		descriptions[i] = packed[j];
+		described[i] = true;
 
-			//ROS_DEBUG("modified feature");
+		if(oldFrame.features.described[i])
+		{
+			compared[nCompared] = i;
+			current[nCompared] = packed[j];
+			previous[nCompared] = oldFrame.features.description[i];
+			nCompared++;
+		}
+	}
 
-			tempFeatures.push_back(checkFrame.features.at(i));
+	int* dist = arena.allocate<int>(nCompared);
+	BriefDescriptor::distances(current, previous, dist, nCompared);
 
-			//ROS_DEBUG("pushed back modified feature");
-		}
-		else{
-			//checkFrame.features.at(i).point->setStatus(Point::TRACKING_LOST); // set the tracking to lost
+	for(int j = 0; j < nCompared; j++)
+	{
+		if(dist[j] > killThreshold)
+		{
 			ROS_DEBUG("feature does'nt match enough, killing");
+			status[compared[j]] = 4;
 		}
 	}
-
-	//ROS_DEBUG("setting new features");
-	checkFrame.features = tempFeatures;
-	//ROS_DEBUG("set new features");
 }
 
 
@@ -247,12 +482,13 @@ double FeatureTracker::averageFeatureChange(Frame& lf, Frame& cf)
 
 	for(int i = 0; i < cf.features.size(); i++)
 	{
-		if(cf.features.at(i).point->observations.size() >= 2)
+		Point* pt = cf.features.point.at(i);
+		if(pt != NULL && pt->observations.size() >= 2)
 		{
-			//ROS_DEBUG_STREAM("from avgFeatChange: " << cf.features.at(i).point->observations.at(1)->frame);
-			cv::Point2f p1 = cf.features.at(i).point->observations.at(1)->undistort_pxl;
-			ROS_ASSERT(cf.features.at(i).undistorted);
-			cv::Point2f p2 = cf.features.at(i).undistort_pxl;
+			//ROS_DEBUG_STREAM("from avgFeatChange: " << pt->observations.at(1).frame);
+			cv::Point2f p1 = pt->observations.at(1).getUndistortedPixel();
+			ROS_ASSERT(cf.features.undistorted.at(i));
+			cv::Point2f p2 = cf.features.undistort_pxl.at(i);
 			//ROS_DEBUG_STREAM("undistorted px: " << p2 << " and " << p1);
 
 			dx = (double)(p1.x - p2.x);
@@ -36,24 +36,88 @@
 #include <tf/transform_broadcaster.h>
 
 #include "Point.h"
+#include "PointPool.h"
+#include "FrameArena.h"
 #include "Feature.h"
 
+#define OPTICAL_FLOW_WINDOW_SIZE 21
+#define OPTICAL_FLOW_PYRAMID_LEVELS 3
+#define OPTICAL_FLOW_MAX_ITERATIONS 30
+#define DEFAULT_PREDICTED_FLOW_PYRAMID_LEVELS 1
+#define DEFAULT_PREDICTED_FLOW_MAX_ITERATIONS 10
+#define DEFAULT_FORWARD_BACKWARD_THRESHOLD 1.0 // pixels
+#define MIN_FLOW_CHUNK_SIZE 16 // the smallest number of features one thread will track
+
 class FeatureTracker {
 
 public:
 
-	std::list<Point> map; // this is a list of all active 3d points
+	/*
+	 * how many tracks each check rejected during the last flow
+	 */
+	struct FlowStats
+	{
+		int flowed; // features which made it into the new frame
+		int lostByStatus; // lucas kanade could not track the feature
+		int lostByForwardBackward; // the backward track did not return to the start
+		int lostByKillRadius; // the track left the region of interest
+		int lostByDissimilarity; // the BRIEF descriptor changed too much
+
+		FlowStats()
+		{
+			flowed = 0;
+			lostByStatus = 0;
+			lostByForwardBackward = 0;
+			lostByKillRadius = 0;
+			lostByDissimilarity = 0;
+		}
+	};
+
+	FlowStats lastFlowStats;
+
+	PointPool map; // this is a pool of all active 3d points
 
 	FeatureTracker();
 	void setParams(int fst, float mev, bool kbd, int nf, int mnfd);
 
+	/*
+	 * tracks which flow outside of this radius are not added to the new frame
+	 * if it is not positive tracks are not culled by radius
+	 */
+	void setKillRadius(float killRadius);
+
+	/*
+	 * sets the pyramid levels and max iterations used when the flow is started from a predicted position
+	 */
+	void setPredictedFlowParams(int levels, int iterations);
+
+	/*
+	 * enables the forward-backward check
+	 * a track is rejected if flowing it back to the old frame lands more than threshold pixels from where it started
+	 */
+	void setForwardBackwardParams(bool check, double threshold);
+
 	std::vector<cv::DMatch> matchFeaturesWithFlann(cv::Mat queryDescriptors, cv::Mat trainDescriptors);
 
-	bool flowFeaturesToNewFrame(Frame& oldFrame, Frame& newFrame);
+	/*
+	 * if cameraRotation is given the search for each feature starts at its position predicted from
+	 * the rotation and the reduced pyramid levels and iterations are used
+	 * cameraRotation rotates vectors in the new camera frame into the old camera frame
+	 *
+	 * lost tracks, tracks outside of the kill radius and dissimilar tracks are culled
+	 * before the survivors are added to the new frame
+	 */
+	bool flowFeaturesToNewFrame(Frame& oldFrame, Frame& newFrame, const Eigen::Matrix3d* cameraRotation = NULL);
+
+	/*
+	 * predicted is resized to the old frame's feature count
+	 */
+	void predictFeaturePositions(Frame& oldFrame, Frame& newFrame, const Eigen::Matrix3d& cameraRotation, ArenaVector<cv::Point2f>& predicted);
 
 	void getCorrespondingPointsFromFrames(Frame lastFrame, Frame currentFrame, std::vector<cv::Point2f>& lastPoints, std::vector<cv::Point2f>& currentPoints);
 
-	void checkFeatureConsistency(Frame& checkFrame, int killThreshold );
+	void checkFeatureConsistency(Frame& oldFrame, Frame& newFrame, const ArenaVector<cv::Point2f>& newPoints, ArenaVector<uchar>& status,
+			ArenaVector<BriefDescriptor>& descriptions, ArenaVector<uchar>& described, int killThreshold);
 
 	void getAndAddNewFeatures(Frame& frame, int nFeatures, int fast_threshold, float kill_radius, int min_feature_dist);
 
@@ -67,6 +131,11 @@ protected:
 	bool KILL_BY_DISSIMILARITY;
 	int NUM_FEATURES;
 	int MIN_NEW_FEATURE_DISTANCE;
+	int PREDICTED_FLOW_PYRAMID_LEVELS;
+	int PREDICTED_FLOW_MAX_ITERATIONS;
+	bool FORWARD_BACKWARD_CHECK;
+	double FORWARD_BACKWARD_THRESHOLD;
+	float KILL_RADIUS;
 
 };
 
@@ -10,11 +10,13 @@
 
 Frame::Frame(cv::Mat img, ros::Time t)
 {
+	generation = 0;
 	this->image = img;
 	this->timeImageCreated = t;
-	descriptionExtractor = cv::xfeatures2d::BriefDescriptorExtractor::create();
+	camera = NULL;
 	frameSet = true;
 	nextFeatureID = 0;
+	pyramidLevels = -1;
 	state = VIOState();
 }
 
@@ -25,9 +27,10 @@ Frame::Frame(cv::Mat img, ros::Time t)
  */
 Frame::Frame(cv::Mat img, ros::Time t, int startingID)
 {
+	generation = 0;
 	this->image = img;
 	this->timeImageCreated = t;
-	descriptionExtractor = cv::xfeatures2d::BriefDescriptorExtractor::create();
+	camera = NULL;
 	frameSet = true;
 	if(startingID > MAXIMUM_ID_NUM){
 		nextFeatureID = 0;
@@ -36,40 +39,85 @@ Frame::Frame(cv::Mat img, ros::Time t, int startingID)
 	else{
 		nextFeatureID = startingID;
 	}
+	pyramidLevels = -1;
 	state = VIOState();
 }
 
 
 Frame::Frame()
 {
-	descriptionExtractor = cv::xfeatures2d::BriefDescriptorExtractor::create();
+	generation = 0;
+	camera = NULL;
 	frameSet = false;
 	nextFeatureID = 0; // assume that this frame starts at zero featureID
+	pyramidLevels = -1;
 	state = VIOState();
 }
 
+bool Frame::set(const cv::Mat& img, ros::Time t, int startingID)
+{
+	this->clear();
+
+	const uchar* buffer = this->image.data;
+	img.copyTo(this->image); // only allocates if the size or type changed
+	this->timeImageCreated = t;
+	frameSet = true;
+	if(startingID > MAXIMUM_ID_NUM){
+		nextFeatureID = 0;
+		ROS_WARN("2D FEATURE ID's ARE OVER FLOWING!");
+	}
+	else{
+		nextFeatureID = startingID;
+	}
+
+	return this->image.data != buffer;
+}
+
+void Frame::clear()
+{
+	generation++;
+	frameSet = false;
+	nextFeatureID = 0;
+	features.clear(); // keeps the capacity of the arrays
+	pyramidLevels = -1; // the pyramid buffers are kept and reused
+	state = VIOState();
+}
 
 bool Frame::addFeature(cv::KeyPoint _corner){
-	//ROS_DEBUG_STREAM("adding feature with ID " << nextFeatureID);
-	features.push_back(Feature(this, _corner.pt, 0, nextFeatureID));
-	nextFeatureID++; // iterate the nextFeatureID
+	this->addFeature(_corner.pt);
 	return true;
 }
 
-bool Frame::addFeature(Feature feat){
+int Frame::addFeature(cv::Point2f px, Point* pt){
 	//ROS_DEBUG_STREAM("adding feature with ID " << nextFeatureID);
-	//set the feature id
-	feat.id = nextFeatureID;
-	features.push_back(feat); // add it to the features vector
+	int index = features.add(px, nextFeatureID, pt); // add it to the feature store
 	nextFeatureID++; // iterate the nextFeatureID
 
-	return true;
+	return index;
 }
 
-static bool wayToSort(Feature i, Feature j)
+/*
+ * the buffers of a feature refill
+ * they are cleared by every refill but keep their capacity so refilling stops allocating after the first few frames
+ * like the frame arena they belong to the vision thread
+ */
+struct RefillScratch
 {
-	//bool v = i.quality<j.quality;
-	return i.quality<j.quality;
+	std::vector<Feature> candidates;
+	std::vector<float> quality;
+	std::vector<int> best;
+
+	// getGridFASTCorners
+	std::vector<bool> occupied;
+	std::vector<cv::Rect> cells;
+	std::vector<cv::Rect> allCells;
+	std::vector<std::vector<cv::KeyPoint> > cellCorners; // only the first cells.size() are used
+};
+
+static RefillScratch& getRefillScratch()
+{
+	static RefillScratch scratch;
+	return scratch;
 }
 
 /*
@@ -83,62 +131,52 @@ static bool wayToSort(Feature i, Feature j)
  * kill_radius: the radius to kill features at
  * min_feature_dist: the minimum distance between new and old features
  */
-int Frame::getAndAddNewFeatures(int nFeatures, int fast_threshold, float kill_radius, int min_feature_dist)
+int Frame::getAndAddNewFeatures(int nFeatures, int fast_threshold, float kill_radius, int min_feature_dist, int grid_rows, int grid_cols)
 {
-	std::vector<Feature> candidates;
+	RefillScratch& scratch = getRefillScratch();
+	std::vector<Feature>& candidates = scratch.candidates;
+
+	// the mask is only rebuilt if the image size or kill radius change
+	const ROIMask& roi = this->getROIMask(kill_radius);
 
 	//get new features
-	candidates = this->getFASTCorners(fast_threshold);
+	if(grid_rows > 0 && grid_cols > 0)
+	{
+		this->getGridFASTCorners(fast_threshold, grid_rows, grid_cols, nFeatures, roi, candidates);
+	}
+	else
+	{
+		this->getFASTCorners(fast_threshold, roi, candidates);
+	}
 
 	ROS_DEBUG_STREAM("got " << candidates.size() << " feats");
 
-	//clean features by kill radius
-	this->cleanUpFeaturesByKillRadius(candidates, kill_radius);
+	//clean features by kill radius and set their radius
+	this->cleanUpFeaturesByKillRadius(candidates, roi);
 
 	//clean features by redundancy
 	ROS_DEBUG_STREAM("before " << candidates.size());
-	this->removeRedundantFeature(candidates, this->features, min_feature_dist);
+	this->buildFeatureGrid(min_feature_dist);
+	this->removeRedundantFeature(candidates, this->featureGrid, min_feature_dist);
 	ROS_DEBUG_STREAM("after " << candidates.size());
 
 	//rank the features
-	this->rankFeatures(candidates, fast_threshold, kill_radius);
+	std::vector<float>& quality = scratch.quality;
+	this->rankFeatures(candidates, kill_radius, quality);
 
 	ROS_DEBUG("ranked");
 
+	// if after all this we have too few features this selects all of them
+	std::vector<int>& best = scratch.best;
+	selectBestFeatures(quality, nFeatures, best);
 
-
+	// the new features are undistorted in one batch by undistortFeatures
+	this->features.reserve(this->features.size() + best.size());
 	int added = 0;
-
-	//if after all this we have too few features only add all of them
-	if(candidates.size() < nFeatures)
+	for(auto& i : best)
 	{
-		for(int i = 0; i < candidates.size(); i++)
-		{
-			Feature feat = Feature(this, candidates.at(i).original_pxl, NULL);
-			this->addFeature(feat);
-			added++;
-		}
-	}
-	else
-	{
-		//For n largest elements (size-n)
-		std::nth_element(candidates.begin(), candidates.begin() + candidates.size() - nFeatures, candidates.end(), wayToSort);
-
-		for(int i = candidates.size() - nFeatures; i < candidates.size(); ++i)
-		{
-			Feature feat = Feature(this, candidates.at(i).original_pxl, NULL);
-				this->addFeature(feat);
-				added++;
-		}
-
-
-/*		for(int i = 0; i < nFeatures; i++)
-		{
-			Feature feat = Feature(this, candidates.at(i).original_pxl, NULL);
-			this->addFeature(feat);
-			added++;
-		}
-*/
+		this->addFeature(candidates.at(i).original_pxl);
+		added++;
 	}
 
 	return added;
@@ -177,15 +215,209 @@ std::vector<Feature> Frame::getFASTCorners(int threshold){
 }
 
 /*
- * gets a point2f vector from the local feature vector
+ * runs FAST on a rectangle of the image and adds the corners which are inside the rectangle and the mask to corners
+ * the rectangle is padded so that corners on its edge are scored and suppressed
+ * exactly like they would be in the full image
  */
-std::vector<cv::Point2f> Frame::getPoint2fVectorFromFeatures(){
-	std::vector<cv::Point2f> points;
-	for (int i = 0; i < this->features.size(); i++)
+static void detectFASTInRect(const cv::Mat& image, cv::Rect rect, const cv::Mat& mask, int threshold, std::vector<cv::KeyPoint>& corners)
+{
+	if(rect.area() <= 0)
 	{
-		points.push_back(this->features.at(i).original_pxl);
+		return;
+	}
+
+	cv::Rect padded = cv::Rect(rect.x - FAST_CELL_PADDING, rect.y - FAST_CELL_PADDING,
+			rect.width + 2 * FAST_CELL_PADDING, rect.height + 2 * FAST_CELL_PADDING) & cv::Rect(0, 0, image.cols, image.rows);
+
+	// each thread keeps its own raw corner buffer so FAST stops allocating once it is big enough
+	static thread_local std::vector<cv::KeyPoint> raw;
+	cv::FAST(image(padded), raw, threshold, true); // detect with nonmax suppression
+
+	for(auto& e : raw)
+	{
+		e.pt.x += padded.x;
+		e.pt.y += padded.y;
+
+		// drop the corners which were found in the padding. they belong to the neighboring rectangle
+		int x = (int)e.pt.x;
+		int y = (int)e.pt.y;
+		if(x >= rect.x && x < rect.x + rect.width && y >= rect.y && y < rect.y + rect.height && mask.at<uchar>(y, x))
+		{
+			corners.push_back(e);
+		}
 	}
-	return points;
+}
+
+/*
+ * get the fast corners from this image which are within the region of interest
+ * FAST is only run over the bounding box of the region of interest
+ * the corners are written to feats which is cleared first
+ *
+ * This function does not check for identical features
+ */
+void Frame::getFASTCorners(int threshold, const ROIMask& roi, std::vector<Feature>& feats){
+	static std::vector<cv::KeyPoint> corners;
+	corners.clear();
+	detectFASTInRect(this->image, roi.bounds, roi.mask, threshold, corners);
+
+	ROS_DEBUG_STREAM("got " << corners.size() << " raw corners in the region of interest");
+
+	feats.clear();
+	for(auto& e : corners)
+	{
+		Feature feat;
+
+		feat.feature = e;
+		feat.original_pxl = e.pt;
+
+		feats.push_back(feat);
+	}
+}
+
+/*
+ * runs FAST on a range of grid cells
+ * each cell is padded so that corners on the cell edge are scored and suppressed
+ * exactly like they would be in the full image
+ */
+class GridFASTInvoker : public cv::ParallelLoopBody
+{
+public:
+	GridFASTInvoker(const cv::Mat& _image, const cv::Mat& _mask, const std::vector<cv::Rect>& _cells, std::vector<std::vector<cv::KeyPoint> >& _cellCorners, int _threshold, int _n_per_cell) :
+		image(_image), mask(_mask), cells(_cells), cellCorners(_cellCorners), threshold(_threshold), n_per_cell(_n_per_cell)
+	{
+	}
+
+	virtual void operator()(const cv::Range& range) const
+	{
+		for(int i = range.start; i < range.end; i++)
+		{
+			// each thread only writes to its own cell's vector
+			std::vector<cv::KeyPoint>& out = cellCorners.at(i);
+			detectFASTInRect(image, cells.at(i), mask, threshold, out);
+
+			cv::KeyPointsFilter::retainBest(out, n_per_cell); // keep the n strongest corners
+		}
+	}
+
+private:
+	const cv::Mat& image;
+	const cv::Mat& mask;
+	const std::vector<cv::Rect>& cells;
+	std::vector<std::vector<cv::KeyPoint> >& cellCorners;
+	int threshold;
+	int n_per_cell;
+};
+
+/*
+ * splits the image into a grid_rows x grid_cols grid and runs FAST on each cell in parallel
+ * cells are clipped to the region of interest and only corners inside of it are kept
+ * cells which already contain a tracked feature are skipped
+ * nFeatures is shared out over the cells which are searched. each keeps its strongest corners
+ * the corners are written to feats which is cleared first
+ *
+ * This function does not check for identical features
+ */
+void Frame::getGridFASTCorners(int threshold, int grid_rows, int grid_cols, int nFeatures, const ROIMask& roi, std::vector<Feature>& feats)
+{
+	ROS_ASSERT(grid_rows > 0 && grid_cols > 0);
+
+	RefillScratch& scratch = getRefillScratch();
+
+	// mark every cell which already has a tracked feature in it
+	std::vector<bool>& occupied = scratch.occupied;
+	occupied.assign(grid_rows * grid_cols, false);
+	for(auto& e : this->features.original_pxl)
+	{
+		occupied.at(this->getGridCellIndex(e, grid_rows, grid_cols)) = true;
+	}
+
+	std::vector<cv::Rect>& cells = scratch.cells;
+	std::vector<cv::Rect>& allCells = scratch.allCells;
+	cells.clear();
+	allCells.clear();
+	for(int r = 0; r < grid_rows; r++)
+	{
+		for(int c = 0; c < grid_cols; c++)
+		{
+			// integer division spreads the remainder pixels across the cells
+			int x0 = c * this->image.cols / grid_cols;
+			int x1 = (c + 1) * this->image.cols / grid_cols;
+			int y0 = r * this->image.rows / grid_rows;
+			int y1 = (r + 1) * this->image.rows / grid_rows;
+			cv::Rect cell = cv::Rect(x0, y0, x1 - x0, y1 - y0) & roi.bounds; // never search outside of the region of interest
+
+			if(cell.area() <= 0)
+			{
+				continue;
+			}
+
+			allCells.push_back(cell);
+			if(!occupied.at(r * grid_cols + c))
+			{
+				cells.push_back(cell);
+			}
+		}
+	}
+
+	// if every cell is taken search all of them so the frame can still be refilled
+	if(cells.empty())
+	{
+		ROS_DEBUG("all grid cells are occupied, searching the entire grid");
+		cells = allCells;
+	}
+
+	// give each searched cell a little more than its share so the radius and redundancy checks still leave enough
+	// the occupied cells are not searched so they get no share
+	int n_per_cell = std::max(1, (int)ceil(2.0 * nFeatures / std::max((int)cells.size(), 1)));
+
+	// the cell vectors are only grown so their capacity is kept between refills
+	std::vector<std::vector<cv::KeyPoint> >& cellCorners = scratch.cellCorners;
+	if(cellCorners.size() < cells.size())
+	{
+		cellCorners.resize(cells.size());
+	}
+	for(int i = 0; i < cells.size(); i++)
+	{
+		cellCorners.at(i).clear();
+	}
+
+	cv::parallel_for_(cv::Range(0, cells.size()), GridFASTInvoker(this->image, roi.mask, cells, cellCorners, threshold, n_per_cell));
+
+	feats.clear();
+	for(int i = 0; i < cells.size(); i++)
+	{
+		for(auto& corner : cellCorners.at(i))
+		{
+			Feature feat;
+
+			feat.feature = corner;
+			feat.original_pxl = corner.pt;
+
+			feats.push_back(feat);
+		}
+	}
+
+	ROS_DEBUG_STREAM("got " << feats.size() << " corners from " << cells.size() << " grid cells");
+}
+
+/*
+ * returns the index of the grid cell which contains this pixel
+ */
+int Frame::getGridCellIndex(cv::Point2f px, int grid_rows, int grid_cols)
+{
+	// the inverse of the integer cell boundaries used in getGridFASTCorners
+	int x = std::min(std::max((int)px.x, 0), this->image.cols - 1);
+	int y = std::min(std::max((int)px.y, 0), this->image.rows - 1);
+	int c = ((x + 1) * grid_cols - 1) / this->image.cols;
+	int r = ((y + 1) * grid_rows - 1) / this->image.rows;
+	return r * grid_cols + c;
+}
+
+/*
+ * gets a point2f vector from the local feature vector
+ */
+std::vector<cv::Point2f> Frame::getPoint2fVectorFromFeatures(){
+	return this->features.original_pxl;
 }
 
 /*
@@ -195,24 +427,71 @@ cv::Mat Frame::extractBRIEFDescriptor(Feature feature){
 	cv::Mat descriptor;
 	std::vector<cv::KeyPoint> kp(1); // must be in the form of a vector
 	kp.push_back((feature.feature));
-	descriptionExtractor->compute(this->image, kp, descriptor);
+	camera->getDescriptionExtractor()->compute(this->image, kp, descriptor);
 	return descriptor;
 }
 
+/*
+ * links each feature from start onwards to its point
+ */
+void Frame::linkFeatures(int start)
+{
+	for(int i = start; i < this->features.size(); i++)
+	{
+		if(this->features.point[i] != NULL)
+		{
+			this->features.point[i]->addObservation(FeatureRef(this, i));
+		}
+	}
+}
+
 /*
  * checks all features and undistorts them if they are not undistorted
  */
 void Frame::undistortFeatures()
 {
-
-
-	for(auto& e : this->features)
+	std::vector<int> indexes;
+	std::vector<cv::Point2f> distorted;
+	for(int i = 0; i < this->features.size(); i++)
 	{
-		if(!e.undistorted)
+		if(!this->features.undistorted[i])
 		{
-			e.undistort(this->K, this->D);
+			indexes.push_back(i);
+			distorted.push_back(this->features.original_pxl[i]);
 		}
 	}
+
+	if(indexes.empty())
+	{
+		return;
+	}
+
+	std::vector<cv::Point2f> undistorted;
+	this->getUndistortionMap().undistort(distorted, undistorted);
+
+	for(int i = 0; i < indexes.size(); i++)
+	{
+		this->features.undistort_pxl[indexes[i]] = undistorted[i];
+		this->features.undistorted[indexes[i]] = true;
+	}
+}
+
+/*
+ * gets the camera's undistortion lookup map for this frame's image size
+ */
+const UndistortionMap& Frame::getUndistortionMap()
+{
+	ROS_ASSERT(this->camera != NULL);
+	return this->camera->getUndistortionMap(this->image.size());
+}
+
+/*
+ * gets the camera's region of interest mask for this frame's image size and the kill radius
+ */
+const ROIMask& Frame::getROIMask(float kill_radius)
+{
+	ROS_ASSERT(this->camera != NULL);
+	return this->camera->getROIMask(this->image.size(), kill_radius);
 }
 
 
@@ -226,48 +505,98 @@ bool Frame::describeFeaturesWithBRIEF(){
 		return false;
 	}
 
-	std::vector<unsigned int> featureIndexes; // the index of the feature keypoints
-	std::vector<cv::KeyPoint> featureKPs; // feature keypoints to be described
-
 	// find all features which must be described
+	FrameArena& arena = FrameArena::get();
+	int* indexes = arena.allocate<int>(features.size());
+	cv::Point2f* pixels = arena.allocate<cv::Point2f>(features.size());
+	int n = 0;
 	for(int i = 0; i < features.size(); i++)
 	{
-		if(!features.at(i).described)
+		if(!features.described[i])
 		{
-			featureIndexes.push_back(i);
-			featureKPs.push_back(features.at(i).feature);
+			indexes[n] = i;
+			pixels[n] = features.original_pxl[i];
+			n++;
 		}
 	}
 
-	cv::Mat descriptions;
-	descriptionExtractor->compute(this->image, featureKPs, descriptions); //describe all un-described keypoints
+	if(n == 0)
+	{
+		return true;
+	}
+
+	BriefDescriptor* descriptions = arena.allocate<BriefDescriptor>(n);
+	uchar* described = arena.allocate<uchar>(n);
+	this->describePixels(pixels, n, descriptions, described); //describe all un-described features
 
-	for(int i = 0; i < descriptions.rows; i++)
+	for(int j = 0; j < n; j++)
 	{
-		cv::Mat desc = descriptions.row(i);
-		features.at(featureIndexes.at(i)).description = desc;
-		features.at(featureIndexes.at(i)).described = true;
+		if(described[j])
+		{
+			features.description[indexes[j]] = descriptions[j];
+			features.described[indexes[j]] = true;
+		}
 	}
 
 	return true;
 
 }
+
+/*
+ * describes every pixel with one extractor call
+ * the class id remembers the pixel index because the extractor drops keypoints near the border
+ * described[i] is false for the pixels which could not be described
+ */
+void Frame::describePixels(const cv::Point2f* pixels, int n, BriefDescriptor* descriptions, uchar* described){
+	std::fill(described, described + n, false);
+
+	if(n == 0)
+	{
+		return;
+	}
+
+	// the extractor needs a std::vector of keypoints
+	std::vector<cv::KeyPoint> kps(n);
+	for(int i = 0; i < n; i++)
+	{
+		kps[i].pt = pixels[i];
+		kps[i].class_id = i;
+	}
+
+	cv::Mat mat;
+	camera->getDescriptionExtractor()->compute(this->image, kps, mat);
+
+	// the extractor may return fewer rows than keypoints. row i belongs to the pixel in kps[i].class_id
+	// and the pixels it dropped are left undescribed
+	for(int i = 0; i < mat.rows && i < kps.size(); i++)
+	{
+		int index = kps.at(i).class_id;
+		if(index < 0 || index >= n)
+		{
+			continue;
+		}
+
+		descriptions[index] = BriefDescriptor(mat.ptr<uchar>(i));
+		described[index] = true;
+	}
+}
+
 /*
  * take a feature vector and describe each of the features
  */
 
-cv::Mat Frame::describeFeaturesWithBRIEF(cv::Mat image, std::vector<Feature> featureVector){
+cv::Mat Frame::describeFeaturesWithBRIEF(cv::Mat image, const std::vector<Feature>& featureVector){
 	//ROS_DEBUG("begin to describe feature with brief");
 	std::vector<cv::KeyPoint> kp; // feature keypoints to be described
 
 	// find all features which must be described
-	for(int i = 0; i < features.size(); i++)
+	for(int i = 0; i < featureVector.size(); i++)
 	{
-		kp.push_back(this->features.at(i).feature);
+		kp.push_back(featureVector.at(i).feature);
 	}
 
 	cv::Mat description;
-	descriptionExtractor->compute(image, kp, description);
+	camera->getDescriptionExtractor()->compute(image, kp, description);
 	//ROS_DEBUG_STREAM("found description with the size" << description.rows << " X " << description.cols);
 	return description;
 }
@@ -280,137 +609,154 @@ cv::Mat Frame::describeFeaturesWithBRIEF(cv::Mat image, std::vector<Feature> fea
  * assumes that the two description vectors match in size
  */
 int Frame::compareDescriptors(cv::Mat desc1, cv::Mat desc2){
-	int sumError = 0;
-	int mask;
-	for(int i = 0; i < desc1.cols; i++)
-	{
-		mask = desc1.at<uchar>(0, i) ^ desc2.at<uchar>(0, i);
-		for(int j = 0; j<8; ++j)
-		{
-			sumError += (mask >> j) & 1;
-		}
-		//error += std::abs(desc2.at<uchar>(0, i) - desc1.at<uchar>(0, i));
-	}
-	return sumError;
+	return (int)cv::norm(desc1, desc2, cv::NORM_HAMMING); // popcount based
 }
 
 
 
-/* Takes Threshold for FAST corner detection and KillRadius of the Region of Interest
- * Defines the quality of all the features and then Sorts them in ascending order of quality.
+/*
+ * scores n features at once from contiguous response and radius arrays
  * 80% of quality depends on feature response and 20% on radius within region of interest.
+ * quality = 0.8 * response + 0.2 * response * sigmoid(5 - 10 * radius / killRadius)
+ *
+ * all of the exponentials are computed with one vectorized cv::exp call
+ * the other loops have no branches so the compiler can vectorize them
  */
-void Frame::rankFeatures(int fastThreshold, int killRadius)
+void Frame::scoreFeatures(const float* response, const float* radius, float* quality, int n, float killRadius)
 {
-	float scaleValue = 0.2 * fastThreshold;
-	int size = features.size();
-	for(int i=0; i<size; ++i)
+	if(n <= 0)
 	{
-		if(features.at(i).quality != -1.0)
-		{
-			//Scaled to 80% from response value and 20% from distance from center
-			features.at(i).quality = (0.8*features.at(i).feature.response +
-					0.2*features.at(i).feature.response *
-					(1/(1+exp(-(5-(10*features.at(i).radius/killRadius))))));
-			//Implemented sigmoid function and scaled to [-5,5]. Actual sigmoid => sigmoid(killRadius/2 - DistanceFromCenter
-		}
+		return;
 	}
-	std::sort(features.begin(), features.end(), wayToSort);
 
-	return;
+	// exp(-(5 - 10 * radius / killRadius))
+	cv::Mat e(1, n, CV_32F, quality); // use the output as the scratch buffer
+	float scale = 10.0f / killRadius;
+	for(int i = 0; i < n; i++)
+	{
+		quality[i] = radius[i] * scale - 5.0f;
+	}
+	cv::exp(e, e);
+
+	for(int i = 0; i < n; i++)
+	{
+		quality[i] = response[i] * (0.8f + 0.2f / (1.0f + quality[i]));
+	}
+}
+
+/*
+ * returns the indexes of the n highest quality features in no particular order
+ * only the index array is partially sorted. If there are n or less features all of their indexes are returned
+ */
+std::vector<int> Frame::selectBestFeatures(const std::vector<float>& quality, int n)
+{
+	std::vector<int> indexes;
+	selectBestFeatures(quality, n, indexes);
+	return indexes;
+}
+
+/*
+ * overloaded writes the indexes into a reused vector
+ */
+void Frame::selectBestFeatures(const std::vector<float>& quality, int n, std::vector<int>& indexes)
+{
+	indexes.resize(quality.size());
+	for(int i = 0; i < indexes.size(); i++)
+	{
+		indexes.at(i) = i;
+	}
+
+	if(n < (int)indexes.size())
+	{
+		n = std::max(n, 0);
+		std::nth_element(indexes.begin(), indexes.begin() + n, indexes.end(),
+				[&quality](int a, int b){return quality[a] > quality[b];});
+		indexes.resize(n);
+	}
 }
 
 /* Takes Threshold for FAST corner detection and KillRadius of the Region of Interest
- * Defines the quality of all the features and then Sorts them in ascending order of quality.
+ * Defines the quality of all the features
  * 80% of quality depends on feature response and 20% on radius within region of interest.
+ * features with a quality of -1 are not ranked
  *
  * overloaded uses referenced feature vector
  */
 void Frame::rankFeatures(std::vector<Feature>& features, int fastThreshold, int killRadius)
 {
-	float scaleValue = 0.2 * fastThreshold;
-	int size = features.size();
-	for(int i=0; i<size; ++i)
+	std::vector<float> quality;
+	this->rankFeatures(features, killRadius, quality);
+
+	for(int i = 0; i < features.size(); i++)
 	{
 		if(features.at(i).quality != -1.0)
 		{
-			//Scaled to 80% from response value and 20% from distance from center
-			features.at(i).quality = (0.8*features.at(i).feature.response +
-					0.2*features.at(i).feature.response *
-					(1/(1+exp(-(5-(10*features.at(i).radius/killRadius))))));
-			//Implemented sigmoid function and scaled to [-5,5]. Actual sigmoid => sigmoid(killRadius/2 - DistanceFromCenter
+			features.at(i).quality = quality.at(i);
 		}
 	}
-	//std::sort(features.begin(), features.end(), wayToSort);
 
 	return;
 }
 
 /*
- * Checks all local frame features for whether or not a feature is outside of the kill radius.
- * It will kill the feature if it is
- * It will set the feature's distance to center if it is not
- * this function ensures that the feature id's remain in ascending order
+ * computes the quality of every feature into a contiguous quality vector
+ * this does not touch the features' quality
  */
-void Frame::cleanUpFeaturesByKillRadius(float killRadius)
+void Frame::rankFeatures(const std::vector<Feature>& features, float killRadius, std::vector<float>& quality)
 {
-	ros::Time t_start = ros::Time::now();
-	cv::Point2f imageCenter = cv::Point2f((float)(this->image.cols / 2), (float)(this->image.rows / 2));
-	std::vector<Feature> oldFeatures = this->features;
-	this->features.clear(); // clear this vector to get new features
-
-	// this ensures that all pointers are still valid
-	for(auto& e : oldFeatures)
+	// gather the inputs so the scoring kernel streams over contiguous memory
+	float* response = FrameArena::get().allocate<float>(features.size());
+	float* radius = FrameArena::get().allocate<float>(features.size());
+	for(int i = 0; i < features.size(); i++)
 	{
-		Feature& feat = e;
-
-		if(this->getAndSetFeatureRadius(feat, imageCenter) <= killRadius)
-		{
-			this->features.push_back(feat);
-			this->features.back().point->observations.at(0) = &this->features.back(); // set the new point observation
-		}
-		else
-		{
-			ROS_DEBUG_STREAM_THROTTLE(2, "removing a feature with radius " << feat.radius);
-			if(feat.point != 0)
-			{
-				//feat.point->setStatus(Point::TRACKING_LOST); // tis will now be cleaned
-				ROS_ASSERT(feat.point != NULL);
-				feat.point->safelyDelete();
-			}
-		}
+		response[i] = features[i].feature.response;
+		radius[i] = features[i].radius;
 	}
 
-	ROS_DEBUG_STREAM("clean by kill radius time: " << 1000 * (ros::Time::now().toSec() - t_start.toSec()));
+	quality.resize(features.size());
+	scoreFeatures(response, radius, quality.data(), features.size(), killRadius);
 }
 
 /*
- * Checks all local frame features for whether or not a feature is outside of the kill radius.
- * It will kill the feature if it is
+ * Checks all features in the referenced vector for whether or not a feature is outside of the kill radius.
+ * It will remove the feature if it is
  * It will set the feature's distance to center if it is not
- * this function ensures that the feature id's remain in ascending order
  *
  * overloaded:
  * uses a referenced feature vector
  */
 void Frame::cleanUpFeaturesByKillRadius(std::vector<Feature>& feats, float killRadius)
 {
-	cv::Point2f imageCenter = cv::Point2f((float)(this->image.cols / 2), (float)(this->image.rows / 2));
-	std::vector<Feature> cleanFeatures;
-	for(int i = 0; i < features.size(); i++)
+	this->cleanUpFeaturesByKillRadius(feats, this->getROIMask(killRadius));
+}
+
+/*
+ * Checks all features in the referenced vector against the region of interest.
+ * It will remove the feature if it is outside
+ * It will set the feature's distance to center from the radius table if it is not
+ */
+void Frame::cleanUpFeaturesByKillRadius(std::vector<Feature>& feats, const ROIMask& roi)
+{
+	// compact the features inside the kill radius to the front of the vector
+	int kept = 0;
+	for(int i = 0; i < feats.size(); i++)
 	{
-		if(this->getAndSetFeatureRadius(features.at(i), imageCenter) <= killRadius)
+		if(roi.contains(feats.at(i).original_pxl))
 		{
-			cleanFeatures.push_back(features.at(i));
+			feats.at(i).radius = roi.radiusAt(feats.at(i).original_pxl);
+			if(kept != i)
+			{
+				feats.at(kept) = feats.at(i);
+			}
+			kept++;
 		}
 		else
 		{
-			ROS_DEBUG_STREAM_THROTTLE(200, "removing a feature with radius " << features.at(i).radius);
+			ROS_DEBUG_STREAM_THROTTLE(200, "removing a feature with radius " << roi.computeRadius(feats.at(i).original_pxl));
 		}
 	}
 
-	//finally set the local feature vector to the new featureVector
-	features = cleanFeatures;
+	feats.resize(kept);
 }
 
 /*
@@ -435,39 +781,60 @@ float Frame::manhattan(cv::Point2f p1, cv::Point2f p2){
  * its features with the compare vector and checking their
  * distances with min_feature_dist
  */
-void Frame::removeRedundantFeature(std::vector<Feature>& toClean, std::vector<Feature> compare, int min_feature_dist)
+void Frame::removeRedundantFeature(std::vector<Feature>& toClean, const std::vector<Feature>& compare, int min_feature_dist)
+{
+	FeatureGrid grid;
+	grid.build(compare, this->image.cols, this->image.rows, min_feature_dist);
+	this->removeRedundantFeature(toClean, grid, min_feature_dist);
+}
+
+/*
+ * removes redundant features from the clean vector by looking up
+ * each feature's neighbors in a prebuilt feature grid
+ * the grid's cell size must be at least min_feature_dist
+ */
+void Frame::removeRedundantFeature(std::vector<Feature>& toClean, const FeatureGrid& grid, int min_feature_dist)
 {
 	ros::Time t_start = ros::Time::now();
-	std::vector<Feature> cleaned;
-	bool removed = false;
 
+	// nothing can be closer than a distance of zero
+	if(min_feature_dist <= 0)
+	{
+		return;
+	}
+
+	ROS_ASSERT(grid.getCellSize() >= min_feature_dist);
+
+	// compact the non redundant features to the front of the vector
+	int kept = 0;
 	for(int i = 0; i < toClean.size(); i++)
 	{
-		for(int j = 0; j < compare.size(); j++)
+		if(!grid.hasNeighbor(toClean.at(i).original_pxl, min_feature_dist))
 		{
-			if(manhattan(toClean.at(i).original_pxl, compare.at(j).original_pxl) < min_feature_dist)
+			if(kept != i)
 			{
-				removed = true;
-				break;
+				toClean.at(kept) = toClean.at(i);
 			}
+			kept++;
 		}
-
-		//if it has not been found to be redundant
-		// push it back into the cleaned vector
-		if(!removed)
-		{
-			cleaned.push_back(toClean.at(i));
-		}
-
-		removed = false;
 	}
 
-	//ROS_DEBUG_STREAM("After cleaning " << toClean.size() << " features, we are left with " << cleaned.size() << " features");
-	toClean = cleaned;
+	//ROS_DEBUG_STREAM("After cleaning " << toClean.size() << " features, we are left with " << kept << " features");
+	toClean.resize(kept);
 
 	ROS_DEBUG_STREAM("time for redundancy check: " << 1000 * (ros::Time::now().toSec() - t_start.toSec()));
 }
 
+/*
+ * buckets this frame's features into the feature grid
+ * cell_size should be the largest distance which will be queried
+ * the grid must be rebuilt if the feature vector changes
+ */
+void Frame::buildFeatureGrid(int cell_size)
+{
+	this->featureGrid.build(this->features.original_pxl, this->image.cols, this->image.rows, cell_size);
+}
+
 /*
  * the transformation must be from world coordinates to camera coordinates (aka form the transform with the inverse of camera pose)
  */
@@ -480,14 +847,45 @@ double Frame::getAverageSceneDepth(tf::Transform w2c)
 
 	double total_depth = 0;
 	int total_points = 0;
-	for(auto& ft : this->features)
+	for(auto& pt : this->features.point)
 	{
-		if(ft.point == NULL)
+		if(pt == NULL)
 			continue;
-		total_depth += a * ft.point->pos(0) + b * ft.point->pos(1) + c * ft.point->pos(2) + d; // add the z parts together
+		total_depth += a * pt->pos(0) + b * pt->pos(1) + c * pt->pos(2) + d; // add the z parts together
 		total_points++;
 	}
 
 	return total_depth / total_points;
 }
 
+/*
+ * gets the optical flow pyramid of this frame's image (with gradients)
+ * it is built with cv::buildOpticalFlowPyramid the first time it is requested
+ * and then reused until a different window size or level count is requested
+ * the returned vector holds the image and its gradient for each level [img0, grad0, img1, grad1, ...]
+ */
+const std::vector<cv::Mat>& Frame::getPyramid(cv::Size winSize, int maxLevel)
+{
+	if(pyramidLevels != maxLevel || pyramidWindow != winSize)
+	{
+		ros::Time t_start = ros::Time::now();
+		cv::buildOpticalFlowPyramid(this->image, this->pyramid, winSize, maxLevel, true);
+		pyramidWindow = winSize;
+		pyramidLevels = maxLevel;
+		ROS_DEBUG_STREAM("built pyramid in: " << 1000 * (ros::Time::now().toSec() - t_start.toSec()));
+	}
+
+	return pyramid;
+}
+
+/*
+ * gets the image at a level of the cached pyramid
+ * level 0 is the full image
+ * the pyramid must have been built already
+ */
+cv::Mat Frame::getPyramidLevel(int level)
+{
+	ROS_ASSERT(this->isPyramidBuilt());
+	ROS_ASSERT(2 * level < pyramid.size());
+	return pyramid.at(2 * level); // the gradient is stored after each level's image. this header does not include the border
+}
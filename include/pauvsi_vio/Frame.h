@@ -15,6 +15,7 @@
 #include "opencv2/features2d/features2d.hpp"
 #include "opencv2/xfeatures2d.hpp"
 #include "opencv2/video.hpp"
+#include <opencv2/core/utility.hpp>
 #include <vector>
 #include <algorithm>
 #include <string>
@@ -23,9 +24,16 @@
 #include "VIOState.hpp"
 
 #include "Point.h"
+#include "FeatureGrid.h"
+#include "ROIMask.h"
+#include "UndistortionMap.h"
+#include "CameraModel.h"
+#include "FrameArena.h"
+#include "FeatureStore.h"
 
 #define DEFAULT_FEATURE_SEARCH_RANGE 5
 #define MAXIMUM_ID_NUM 1000000000 //this is the maximum size that a feature ID should be to ensure there are no overflow issues.
+#define FAST_CELL_PADDING 4 // extra pixels around each grid cell so FAST can score and suppress corners right up to the cell edge
 
 class Feature;
 
@@ -33,25 +41,31 @@ class Frame
 {
 
 private:
-	cv::Ptr<cv::xfeatures2d::BriefDescriptorExtractor> descriptionExtractor;
 	bool frameSet;
 
+	// the optical flow pyramid of this image. built once the first time it is needed
+	std::vector<cv::Mat> pyramid;
+	cv::Size pyramidWindow; // the window size the pyramid was padded for
+	int pyramidLevels; // the max level that was requested for the pyramid. -1 if it is not built
+
 public:
 	ros::Time timeImageCreated;
 
 	cv::Mat image;
 
-	cv::Mat K;
+	CameraModel* camera; // the camera which took this image. shared by all frames
 
-	cv::Mat D;
+	FeatureStore features; //the features of this frame stored as parallel arrays. an index is never reused or moved
 
-	std::vector<Feature> features; //the feature vector for this frame
+	FeatureGrid featureGrid; // spatial index of the features. only valid right after buildFeatureGrid
 
 	VIOState state;
 
 	//this ensures that all features have a unique ID
 	int nextFeatureID; // the id of the next feature that is added to this frame or the next frame
 
+	unsigned int generation; // incremented every time this frame's slot is reused for a new image
+
 	bool operator==(const Frame& f){
 		return f.nextFeatureID == this->nextFeatureID;
 	}
@@ -76,6 +90,22 @@ public:
 	 */
 	Frame();
 
+	/*
+	 * reuses this frame for a new image
+	 * the image is copied into the existing image buffer and the feature arrays keep their capacity
+	 * so nothing is allocated once the frame has held an image of the same size
+	 * the generation is incremented so old handles to this frame become invalid
+	 *
+	 * returns true if the image buffer had to be allocated
+	 */
+	bool set(const cv::Mat& img, ros::Time t, int startingID);
+
+	/*
+	 * unsets this frame but keeps all of its buffers
+	 * the generation is incremented so old handles to this frame become invalid
+	 */
+	void clear();
+
 	bool isFrameSet(){
 		return frameSet;
 	}
@@ -90,7 +120,11 @@ public:
 
 	bool addFeature(cv::KeyPoint _corner);
 
-	bool addFeature(Feature feat);
+	/*
+	 * appends a feature with the next feature id and returns its index
+	 * the feature is not linked to pt's observations until linkFeatures is called
+	 */
+	int addFeature(cv::Point2f px, Point* pt = NULL);
 	/*
 	 * this will use the fast algorithm to find new features in the image
 	 * it will then kill all features outside the kill radius
@@ -101,8 +135,10 @@ public:
 	 * fast_threshold: the threshold to use with the fast algorithm
 	 * kill_radius: the radius to kill features at
 	 * min_feature_dist: the minimum distance between new and old features
+	 * grid_rows, grid_cols: if both are positive the corners are detected per grid cell (see getGridFASTCorners)
+	 * otherwise FAST is run over the whole image
 	 */
-	int getAndAddNewFeatures(int nFeatures, int fast_threshold, float kill_radius, int min_feature_dist);
+	int getAndAddNewFeatures(int nFeatures, int fast_threshold, float kill_radius, int min_feature_dist, int grid_rows = 0, int grid_cols = 0);
 
 	/*
 	 * get the fast corners from this image
@@ -112,6 +148,32 @@ public:
 	 */
 	std::vector<Feature> getFASTCorners(int threshold);
 
+	/*
+	 * get the fast corners from this image which are within the region of interest
+	 * FAST is only run over the bounding box of the region of interest
+	 * the corners are written to feats which is cleared first
+	 *
+	 * This function does not check for identical features
+	 */
+	void getFASTCorners(int threshold, const ROIMask& roi, std::vector<Feature>& feats);
+
+	/*
+	 * splits the image into a grid_rows x grid_cols grid and runs FAST on each cell in parallel
+	 * cells are clipped to the region of interest and only corners inside of it are kept
+	 * cells which already contain a tracked feature are skipped
+	 * nFeatures is shared out over the cells which are searched. each keeps its strongest corners
+	 *
+	 * the corners are written to feats which is cleared first
+	 *
+	 * This function does not check for identical features
+	 */
+	void getGridFASTCorners(int threshold, int grid_rows, int grid_cols, int nFeatures, const ROIMask& roi, std::vector<Feature>& feats);
+
+	/*
+	 * returns the index of the grid cell which contains this pixel
+	 */
+	int getGridCellIndex(cv::Point2f px, int grid_rows, int grid_cols);
+
 	/*
 	 * gets the a keypoint vector form the feature vector
 	 */
@@ -162,19 +224,43 @@ public:
 
 	/*
 	 * checks all features and undistorts them if they are not undistorted
+	 * all of them are undistorted in one batch through the undistortion map
 	 */
 	void undistortFeatures();
 
+	/*
+	 * adds every feature from index start onwards to its point's observations
+	 * this is done once the features vector is final so the observation pointers stay valid
+	 */
+	void linkFeatures(int start = 0);
+
+	/*
+	 * gets the camera's undistortion lookup map for this frame's image size
+	 */
+	const UndistortionMap& getUndistortionMap();
+
+	/*
+	 * gets the camera's region of interest mask for this frame's image size and the kill radius
+	 */
+	const ROIMask& getROIMask(float kill_radius);
+
 	/*
 	 * searches for all features in a the local feature vector that have not been described
 	 * and describes them using the BRIEF algorithm
+	 * all of them are described with one extractor call
+	 * features too close to the image border to be described stay undescribed
 	 */
 	bool describeFeaturesWithBRIEF();
+	/*
+	 * describes n pixels in this frame's image with one extractor call
+	 * described[i] is false if pixel i was too close to the border
+	 */
+	void describePixels(const cv::Point2f* pixels, int n, BriefDescriptor* descriptions, uchar* described);
 	/*
 	 * take a feature vector and describe each of the features
 	 */
 
-	cv::Mat describeFeaturesWithBRIEF(cv::Mat image, std::vector<Feature> featureVector);
+	cv::Mat describeFeaturesWithBRIEF(cv::Mat image, const std::vector<Feature>& featureVector);
 
 	/*
 	 * compares two descriptors
@@ -185,41 +271,56 @@ public:
 	 */
 	int compareDescriptors(cv::Mat desc1, cv::Mat desc2);
 
-	//static bool wayToSort(Feature i, Feature j);
-
-	/* Takes Threshold for FAST corner detection and KillRadius of the Region of Interest
-	 * Defines the quality of all the features and then Sorts them in ascending order of quality.
-	 * 80% of quality depends on feature response and 20% on radius within region of interest.
-	 */
-	void rankFeatures(int fastThreshold, int killRadius);
-
 	/* Takes Threshold for FAST corner detection and KillRadius of the Region of Interest
-	 * Defines the quality of all the features and then Sorts them in ascending order of quality.
+	 * Defines the quality of all the features
 	 * 80% of quality depends on feature response and 20% on radius within region of interest.
+	 * features with a quality of -1 are not ranked
 	 *
 	 * overloaded uses referenced feature vector
 	 */
 	void rankFeatures(std::vector<Feature>& features, int fastThreshold, int killRadius);
 
 	/*
-	 * Checks all local frame features for whether or not a feature is outside of the kill radius.
-	 * It will kill the feature if it is
-	 * It will set the feature's distance to center if it is not
-	 * this function ensures that the feature id's remain in ascending order
+	 * computes the quality of every feature into a contiguous quality vector
+	 * this does not touch the features' quality
+	 */
+	void rankFeatures(const std::vector<Feature>& features, float killRadius, std::vector<float>& quality);
+
+	/*
+	 * scores n features at once from contiguous response and radius arrays
+	 * quality = 0.8 * response + 0.2 * response * sigmoid(5 - 10 * radius / killRadius)
+	 * all of the exponentials are computed with one vectorized cv::exp call
+	 */
+	static void scoreFeatures(const float* response, const float* radius, float* quality, int n, float killRadius);
+
+	/*
+	 * returns the indexes of the n highest quality features in no particular order
+	 * only the index array is partially sorted. If there are n or less features all of their indexes are returned
 	 */
-	void cleanUpFeaturesByKillRadius(float killRadius);
+	static std::vector<int> selectBestFeatures(const std::vector<float>& quality, int n);
 
 	/*
-	 * Checks all local frame features for whether or not a feature is outside of the kill radius.
-	 * It will kill the feature if it is
+	 * overloaded writes the indexes into a reused vector
+	 */
+	static void selectBestFeatures(const std::vector<float>& quality, int n, std::vector<int>& indexes);
+
+	/*
+	 * Checks all features in the referenced vector for whether or not a feature is outside of the kill radius.
+	 * It will remove the feature if it is
 	 * It will set the feature's distance to center if it is not
-	 * this function ensures that the feature id's remain in ascending order
 	 *
 	 * overloaded:
 	 * uses a referenced feature vector
 	 */
 	void cleanUpFeaturesByKillRadius(std::vector<Feature>& feats, float killRadius);
 
+	/*
+	 * Checks all features in the referenced vector against the region of interest.
+	 * It will remove the feature if it is outside
+	 * It will set the feature's distance to center from the radius table if it is not
+	 */
+	void cleanUpFeaturesByKillRadius(std::vector<Feature>& feats, const ROIMask& roi);
+
 	/*
 	 * this will check the feature's radius and both set an its radius
 	 */
@@ -235,11 +336,62 @@ public:
 	 * its features with the compare vector and checking their
 	 * distances with min_feature_dist
 	 */
-	void removeRedundantFeature(std::vector<Feature>& toClean, std::vector<Feature> compare, int min_feature_dist);
+	void removeRedundantFeature(std::vector<Feature>& toClean, const std::vector<Feature>& compare, int min_feature_dist);
+
+	/*
+	 * removes redundant features from the clean vector by looking up
+	 * each feature's neighbors in a prebuilt feature grid
+	 * the grid's cell size must be at least min_feature_dist
+	 */
+	void removeRedundantFeature(std::vector<Feature>& toClean, const FeatureGrid& grid, int min_feature_dist);
+
+	/*
+	 * buckets this frame's features into the feature grid
+	 * cell_size should be the largest distance which will be queried
+	 * the grid must be rebuilt if the feature vector changes
+	 */
+	void buildFeatureGrid(int cell_size);
 
 
 	double getAverageSceneDepth(tf::Transform w2c);
 
+	/*
+	 * gets the optical flow pyramid of this frame's image (with gradients)
+	 * it is built with cv::buildOpticalFlowPyramid the first time it is requested
+	 * and then reused until a different window size or level count is requested
+	 * the returned vector holds the image and its gradient for each level [img0, grad0, img1, grad1, ...]
+	 */
+	const std::vector<cv::Mat>& getPyramid(cv::Size winSize, int maxLevel);
+
+	/*
+	 * gets the image at a level of the cached pyramid
+	 * level 0 is the full image
+	 * the pyramid must have been built already
+	 */
+	cv::Mat getPyramidLevel(int level);
+
+	bool isPyramidBuilt(){
+		return pyramidLevels >= 0;
+	}
+
+	/*
+	 * frees the pyramid once this frame will not be flowed from again
+	 */
+	void releasePyramid(){
+		pyramid.clear();
+		pyramidLevels = -1;
+	}
+
+	/*
+	 * takes the pyramid buffers of a frame which will not be flowed from again
+	 * this frame's pyramid is then built into them without allocating
+	 */
+	void takePyramidBuffers(Frame& other){
+		std::swap(this->pyramid, other.pyramid);
+		this->pyramidLevels = -1;
+		other.pyramidLevels = -1;
+	}
+
 
 };
 
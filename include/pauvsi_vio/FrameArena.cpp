@@ -0,0 +1,93 @@
+/*
+ * FrameArena.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "FrameArena.h"
+
+FrameArena::FrameArena(size_t blockSize)
+{
+	this->blockSize = blockSize;
+	this->offset = 0;
+	this->used = 0;
+	this->blockAllocations = 0;
+}
+
+FrameArena::~FrameArena()
+{
+	for(auto& e : blocks)
+	{
+		delete[] e.data;
+	}
+}
+
+FrameArena& FrameArena::get()
+{
+	static FrameArena arena;
+	return arena;
+}
+
+void FrameArena::addBlock(size_t size)
+{
+	Block b;
+	b.data = new char[size];
+	b.size = size;
+	blocks.push_back(b);
+	offset = 0;
+	blockAllocations++;
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment)
+{
+	if(bytes == 0)
+	{
+		bytes = 1; // every allocation gets its own address
+	}
+
+	if(!blocks.empty())
+	{
+		Block& b = blocks.back();
+		size_t aligned = (reinterpret_cast<size_t>(b.data + offset) + alignment - 1) & ~(alignment - 1);
+		size_t start = aligned - reinterpret_cast<size_t>(b.data);
+		if(start + bytes <= b.size)
+		{
+			offset = start + bytes;
+			used += bytes;
+			return b.data + start;
+		}
+	}
+
+	// the last block is full so start a new one which is large enough
+	this->addBlock(std::max(blockSize, bytes + alignment));
+	return this->allocate(bytes, alignment);
+}
+
+void FrameArena::reset()
+{
+	// merge the blocks so the next frame fits into one
+	if(blocks.size() > 1)
+	{
+		size_t total = this->getCapacity();
+		for(auto& e : blocks)
+		{
+			delete[] e.data;
+		}
+		blocks.clear();
+		this->addBlock(total);
+	}
+
+	offset = 0;
+	used = 0;
+}
+
+size_t FrameArena::getCapacity() const
+{
+	size_t total = 0;
+	for(auto& e : blocks)
+	{
+		total += e.size;
+	}
+	return total;
+}
@@ -0,0 +1,133 @@
+/*
+ * FrameArena.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_FRAMEARENA_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_FRAMEARENA_H_
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#define FRAME_ARENA_BLOCK_SIZE (1 << 20) // 1 MB
+
+/*
+ * a monotonic arena for the scratch buffers of one frame
+ * allocating is a pointer bump and nothing is freed until reset
+ *
+ * when a frame needs more than the arena holds another block is added
+ * on reset all blocks are merged into one big enough for the whole frame
+ * so after the first few frames the vision pipeline's scratch memory is never allocated
+ *
+ * the arena is not thread safe. parallel code must get its buffers from it before it starts
+ */
+class FrameArena
+{
+public:
+
+	FrameArena(size_t blockSize = FRAME_ARENA_BLOCK_SIZE);
+
+	~FrameArena();
+
+	/*
+	 * the arena of the vision thread. it is reset at the end of every VIO::run
+	 */
+	static FrameArena& get();
+
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+	template <typename T>
+	T* allocate(size_t n){
+		return static_cast<T*>(this->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	/*
+	 * frees everything that was allocated since the last reset
+	 */
+	void reset();
+
+	/*
+	 * the bytes allocated since the last reset
+	 */
+	size_t getBytesUsed() const {
+		return used;
+	}
+
+	size_t getCapacity() const;
+
+	/*
+	 * the number of blocks the arena has allocated on the heap
+	 */
+	int getBlockAllocations() const {
+		return blockAllocations;
+	}
+
+private:
+
+	struct Block
+	{
+		char* data;
+		size_t size;
+	};
+
+	std::vector<Block> blocks; // the last block is the one being allocated from
+	size_t offset; // the offset into the last block
+	size_t used;
+	size_t blockSize;
+	int blockAllocations;
+
+	void addBlock(size_t size);
+
+	// the arena owns raw blocks so it can not be copied
+	FrameArena(const FrameArena&);
+	FrameArena& operator=(const FrameArena&);
+};
+
+/*
+ * lets standard containers take their memory from a frame arena
+ * deallocate does nothing. the memory is freed when the arena is reset
+ * a container using this must not outlive the frame
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	FrameArena* arena;
+
+	ArenaAllocator(FrameArena& _arena = FrameArena::get()) : arena(&_arena) {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t n){
+		return arena->allocate<T>(n);
+	}
+
+	void deallocate(T*, size_t){
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const {
+		return arena == other.arena;
+	}
+
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const {
+		return arena != other.arena;
+	}
+};
+
+/*
+ * a vector whose memory comes from the frame arena
+ */
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_FRAMEARENA_H_ */
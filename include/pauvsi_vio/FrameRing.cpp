@@ -0,0 +1,58 @@
+/*
+ * FrameRing.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "FrameRing.h"
+
+FrameRing::FrameRing()
+{
+	head = 0;
+	count = 0;
+	imageAllocations = 0;
+}
+
+void FrameRing::allocate(int capacity)
+{
+	ROS_ASSERT(capacity >= 2); // the current and last frame are always needed
+	ROS_ASSERT(slots.empty());
+	slots.reserve(capacity);
+	for(int i = 0; i < capacity; i++)
+	{
+		slots.push_back(Frame()); // the slots keep their image and feature storage between uses
+	}
+	head = 0;
+	count = 0;
+}
+
+Frame& FrameRing::advance()
+{
+	ROS_ASSERT(!slots.empty());
+	head = (head + slots.size() - 1) % slots.size();
+
+	if(count < slots.size())
+	{
+		count++;
+	}
+
+	return slots[head];
+}
+
+Frame& FrameRing::push()
+{
+	Frame& f = this->advance();
+	f.clear(); // invalidates the evicted frame's handles
+	return f;
+}
+
+Frame& FrameRing::push(const cv::Mat& img, ros::Time t, int startingID)
+{
+	Frame& f = this->advance();
+	if(f.set(img, t, startingID)) // invalidates the evicted frame's handles
+	{
+		imageAllocations++;
+	}
+	return f;
+}
@@ -0,0 +1,98 @@
+/*
+ * FrameRing.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_FRAMERING_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_FRAMERING_H_
+
+#include <vector>
+#include <ros/ros.h>
+
+#include "Frame.h"
+
+/*
+ * a fixed capacity ring of frames. the newest frame is at index 0
+ *
+ * every slot is allocated once in allocate() and reused when the oldest frame is evicted
+ * so a Frame* into the ring never dangles. it points to whatever frame reuses the slot
+ * which is why everything that refers to a frame also keeps its generation (see FeatureRef and KeyFrame)
+ *
+ * eviction is O(1): the slot's generation is incremented and nothing else has to be touched
+ */
+class FrameRing
+{
+public:
+
+	FrameRing();
+
+	/*
+	 * allocates all slots. must be called before the first push
+	 */
+	void allocate(int capacity);
+
+	/*
+	 * pushes an unset frame
+	 */
+	Frame& push();
+
+	/*
+	 * pushes a frame for this image
+	 * the oldest frame is evicted if the ring is full
+	 */
+	Frame& push(const cv::Mat& img, ros::Time t, int startingID);
+
+	/*
+	 * the i-th newest frame
+	 */
+	Frame& at(int i){
+		ROS_ASSERT(i >= 0 && i < count);
+		return slots[(head + i) % slots.size()];
+	}
+
+	Frame& front(){
+		return this->at(0);
+	}
+
+	Frame& back(){
+		return this->at(count - 1);
+	}
+
+	int size() const {
+		return count;
+	}
+
+	int capacity() const {
+		return slots.size();
+	}
+
+	bool full() const {
+		return count == slots.size();
+	}
+
+	/*
+	 * the number of times a slot's image buffer had to be allocated
+	 * once every slot has held an image of the current size this stops growing
+	 */
+	int getImageAllocations() const {
+		return imageAllocations;
+	}
+
+private:
+
+	std::vector<Frame> slots; // never resized after allocate so the frames never move
+	int head; // the slot of the newest frame
+	int count;
+	int imageAllocations;
+
+	/*
+	 * moves the head back one slot and evicts the oldest frame if it is full
+	 */
+	Frame& advance();
+};
+
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_FRAMERING_H_ */
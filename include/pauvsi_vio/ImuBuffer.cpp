@@ -0,0 +1,140 @@
+/*
+ * ImuBuffer.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "ImuBuffer.h"
+
+ImuBuffer::ImuBuffer() : head(0), tail(0), dropped(0)
+{
+	newestStamp = 0;
+}
+
+void ImuBuffer::allocate(int capacity)
+{
+	ROS_ASSERT(capacity > 0);
+	slots.resize(capacity);
+	stamps.resize(capacity);
+	head.store(0);
+	tail.store(0);
+	newestStamp = 0;
+}
+
+bool ImuBuffer::push(const ImuSample& sample)
+{
+	unsigned long t = tail.load(std::memory_order_relaxed);
+	unsigned long h = head.load(std::memory_order_acquire);
+
+	if(t - h >= slots.size())
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		ROS_WARN_STREAM_THROTTLE(1, "imu buffer is full. dropping imu sample");
+		return false;
+	}
+
+	if(t != 0 && sample.stamp < newestStamp)
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		ROS_WARN_STREAM_THROTTLE(1, "imu sample is out of order. dropping it");
+		return false;
+	}
+
+	int slot = t % slots.size();
+	slots[slot] = sample;
+	stamps[slot] = sample.stamp;
+	newestStamp = sample.stamp;
+
+	tail.store(t + 1, std::memory_order_release); // publish the sample
+	return true;
+}
+
+int ImuBuffer::size() const
+{
+	return tail.load(std::memory_order_acquire) - head.load(std::memory_order_relaxed);
+}
+
+const ImuSample& ImuBuffer::back() const
+{
+	unsigned long t = tail.load(std::memory_order_acquire);
+	ROS_ASSERT(t != head.load(std::memory_order_relaxed));
+	return slots[(t - 1) % slots.size()];
+}
+
+ImuSpan ImuBuffer::between(int64_t t0, int64_t t1) const
+{
+	unsigned long h = head.load(std::memory_order_relaxed);
+	unsigned long t = tail.load(std::memory_order_acquire);
+
+	unsigned long begin = this->search(h, t, t0, false);
+	unsigned long end = this->search(begin, t, t1, true);
+
+	return this->span(begin, end);
+}
+
+const ImuSample* ImuBuffer::atOrBefore(int64_t t) const
+{
+	unsigned long h = head.load(std::memory_order_relaxed);
+	unsigned long after = this->search(h, tail.load(std::memory_order_acquire), t, false);
+
+	if(after == h)
+	{
+		return NULL;
+	}
+
+	return &slots[(after - 1) % slots.size()];
+}
+
+int ImuBuffer::evictBefore(int64_t t)
+{
+	unsigned long h = head.load(std::memory_order_relaxed);
+	unsigned long end = this->search(h, tail.load(std::memory_order_acquire), t, true);
+
+	head.store(end, std::memory_order_release); // hand the slots back to the producer
+	return end - h;
+}
+
+unsigned long ImuBuffer::search(unsigned long begin, unsigned long end, int64_t t, bool inclusive) const
+{
+	// the stamps are sorted so this is a lower/upper bound over the counters
+	while(begin < end)
+	{
+		unsigned long mid = begin + (end - begin) / 2;
+		int64_t stamp = stamps[mid % stamps.size()];
+
+		if(stamp < t || (!inclusive && stamp == t))
+		{
+			begin = mid + 1;
+		}
+		else
+		{
+			end = mid;
+		}
+	}
+
+	return begin;
+}
+
+ImuSpan ImuBuffer::span(unsigned long begin, unsigned long end) const
+{
+	ImuSpan s;
+	if(begin >= end)
+	{
+		return s;
+	}
+
+	int n = end - begin;
+	int start = begin % slots.size();
+	int firstSize = std::min(n, (int)slots.size() - start);
+
+	s.first = &slots[start];
+	s.firstSize = firstSize;
+	if(firstSize < n)
+	{
+		s.second = &slots[0];
+		s.secondSize = n - firstSize;
+	}
+
+	return s;
+}
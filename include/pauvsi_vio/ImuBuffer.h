@@ -0,0 +1,142 @@
+/*
+ * ImuBuffer.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_IMUBUFFER_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_IMUBUFFER_H_
+
+#include <vector>
+#include <atomic>
+#include <ros/ros.h>
+
+#include "ImuSample.h"
+
+#define IMU_BUFFER_LENGTH_DEFAULT 2048
+
+/*
+ * a view of a run of imu samples in the buffer without copying them
+ * the run can wrap around the end of the ring so it is made of up to two contiguous parts
+ * it stays valid until the samples are evicted
+ */
+struct ImuSpan
+{
+	const ImuSample* first;
+	int firstSize;
+	const ImuSample* second;
+	int secondSize;
+
+	ImuSpan() : first(NULL), firstSize(0), second(NULL), secondSize(0) {}
+
+	int size() const {
+		return firstSize + secondSize;
+	}
+
+	bool empty() const {
+		return this->size() == 0;
+	}
+
+	const ImuSample& operator[](int i) const {
+		return (i < firstSize) ? first[i] : second[i - firstSize];
+	}
+
+	const ImuSample& back() const {
+		return (*this)[this->size() - 1];
+	}
+};
+
+/*
+ * a fixed capacity ring of imu samples ordered by time
+ *
+ * there is one producer (the imu callback) which calls push
+ * and one consumer (the camera pipeline) which calls everything else
+ * they may run on different threads. the only shared state is the head and tail counters
+ * a slot is written before the tail is published and is not reused until the consumer evicts it
+ *
+ * samples which are older than the newest sample are dropped so the ring stays sorted
+ * if the ring is full the new sample is dropped. the consumer must evict to make room
+ */
+class ImuBuffer
+{
+public:
+
+	ImuBuffer();
+
+	/*
+	 * allocates the ring. this must be done before either thread uses it
+	 */
+	void allocate(int capacity);
+
+	int capacity() const {
+		return slots.size();
+	}
+
+	/*
+	 * producer: appends a sample
+	 * returns false if it was dropped
+	 */
+	bool push(const ImuSample& sample);
+
+	/*
+	 * the number of samples which were dropped by push
+	 */
+	unsigned long getDropped() const {
+		return dropped.load(std::memory_order_relaxed);
+	}
+
+	/*
+	 * consumer: the number of samples currently in the ring
+	 */
+	int size() const;
+
+	bool empty() const {
+		return this->size() == 0;
+	}
+
+	/*
+	 * consumer: the newest sample. the ring must not be empty
+	 */
+	const ImuSample& back() const;
+
+	/*
+	 * consumer: all samples with t0 < stamp < t1 (nanoseconds)
+	 * both ends are found with a binary search
+	 */
+	ImuSpan between(int64_t t0, int64_t t1) const;
+
+	/*
+	 * consumer: the newest sample with stamp <= t (nanoseconds). NULL if there is none
+	 */
+	const ImuSample* atOrBefore(int64_t t) const;
+
+	/*
+	 * consumer: removes all samples with stamp < t (nanoseconds)
+	 * returns the number of samples removed
+	 */
+	int evictBefore(int64_t t);
+
+private:
+
+	std::vector<ImuSample> slots;
+	std::vector<int64_t> stamps; // the stamp of each slot kept apart so the search only touches these
+
+	// monotonic counters. the slot of counter c is c % capacity
+	std::atomic<unsigned long> head; // written by the consumer
+	std::atomic<unsigned long> tail; // written by the producer
+
+	int64_t newestStamp; // only used by the producer
+	std::atomic<unsigned long> dropped;
+
+	/*
+	 * the counter of the first sample in [begin, end) with stamp > t (or >= t if inclusive)
+	 */
+	unsigned long search(unsigned long begin, unsigned long end, int64_t t, bool inclusive) const;
+
+	ImuSpan span(unsigned long begin, unsigned long end) const;
+};
+
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_IMUBUFFER_H_ */
@@ -0,0 +1,178 @@
+/*
+ * ImuPreintegration.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "ImuPreintegration.h"
+
+/*
+ * the cross product matrix of v
+ */
+static Eigen::Matrix3d skew(const Eigen::Vector3d& v)
+{
+	Eigen::Matrix3d m;
+	m << 0, -v(2), v(1),
+			v(2), 0, -v(0),
+			-v(1), v(0), 0;
+	return m;
+}
+
+/*
+ * the rotation exp(phi)
+ */
+static Eigen::Quaterniond expMap(const Eigen::Vector3d& phi)
+{
+	double angle = phi.norm();
+	if(angle == 0)
+	{
+		return Eigen::Quaterniond::Identity();
+	}
+
+	return Eigen::Quaterniond(Eigen::AngleAxisd(angle, phi / angle));
+}
+
+/*
+ * the right jacobian of SO3: exp(phi + d) = exp(phi) * exp(Jr(phi) * d) for a small d
+ */
+static Eigen::Matrix3d rightJacobian(const Eigen::Vector3d& phi)
+{
+	double angle = phi.norm();
+	Eigen::Matrix3d W = skew(phi);
+
+	if(angle < 1e-5)
+	{
+		return Eigen::Matrix3d::Identity() - 0.5 * W;
+	}
+
+	double angle2 = angle * angle;
+	return Eigen::Matrix3d::Identity() - ((1 - cos(angle)) / angle2) * W + ((angle - sin(angle)) / (angle2 * angle)) * W * W;
+}
+
+ImuPreintegration::ImuPreintegration()
+{
+	gyroNoiseDensity = GYRO_NOISE_DENSITY_DEFAULT;
+	accelNoiseDensity = ACCEL_NOISE_DENSITY_DEFAULT;
+	this->reset();
+}
+
+void ImuPreintegration::setNoise(double gyroNoiseDensity, double accelNoiseDensity)
+{
+	this->gyroNoiseDensity = gyroNoiseDensity;
+	this->accelNoiseDensity = accelNoiseDensity;
+}
+
+void ImuPreintegration::reset()
+{
+	deltaTime = 0;
+	deltaR.setIdentity();
+	deltaV.setZero();
+	deltaP.setZero();
+
+	covariance.setZero();
+
+	dR_dbg.setZero();
+	dv_dbg.setZero();
+	dv_dba.setZero();
+	dp_dbg.setZero();
+	dp_dba.setZero();
+}
+
+void ImuPreintegration::integrate(const Eigen::Vector3d& alpha, const Eigen::Vector3d& omega, double dt)
+{
+	if(dt <= 0)
+	{
+		return;
+	}
+
+	double dt2 = dt * dt;
+	Eigen::Matrix3d R = deltaR.toRotationMatrix();
+	Eigen::Matrix3d Ra_x = R * skew(alpha);
+
+	Eigen::Vector3d phi = omega * dt;
+	Eigen::Quaterniond dq = expMap(phi);
+	Eigen::Matrix3d dRt = dq.toRotationMatrix().transpose();
+	Eigen::Matrix3d Jr = rightJacobian(phi);
+
+	// propagate the covariance with the deltas at the start of the step. P = A * P * A^T + B * Q * B^T with
+	// A = | dR^T              0     0 |   B = | Jr*dt  0           |
+	//     | -R[a]x*dt         I     0 |       | 0      R*dt        |
+	//     | -R[a]x*dt^2/2     I*dt  I |       | 0      R*dt^2/2    |
+	// A is applied one 3 wide block row and then block column at a time like VIOEKF::propagateCovariance
+	Eigen::Matrix3d Av = -dt * Ra_x;
+	Eigen::Matrix3d Ap = -0.5 * dt2 * Ra_x;
+
+	Eigen::Matrix<double, 9, 9> AP;
+	AP.middleRows<3>(0).noalias() = dRt * covariance.middleRows<3>(0);
+	AP.middleRows<3>(3) = covariance.middleRows<3>(3);
+	AP.middleRows<3>(3).noalias() += Av * covariance.middleRows<3>(0);
+	AP.middleRows<3>(6) = covariance.middleRows<3>(6) + dt * covariance.middleRows<3>(3);
+	AP.middleRows<3>(6).noalias() += Ap * covariance.middleRows<3>(0);
+
+	covariance.middleCols<3>(0).noalias() = AP.middleCols<3>(0) * dRt.transpose();
+	covariance.middleCols<3>(3) = AP.middleCols<3>(3);
+	covariance.middleCols<3>(3).noalias() += AP.middleCols<3>(0) * Av.transpose();
+	covariance.middleCols<3>(6) = AP.middleCols<3>(6) + dt * AP.middleCols<3>(3);
+	covariance.middleCols<3>(6).noalias() += AP.middleCols<3>(0) * Ap.transpose();
+
+	// the noise of a reading held for dt has variance density^2 / dt. R * R^T = I so the accel part is diagonal
+	double gyroVar = gyroNoiseDensity * gyroNoiseDensity * dt;
+	double accelVar = accelNoiseDensity * accelNoiseDensity;
+	covariance.block<3, 3>(0, 0).noalias() += gyroVar * Jr * Jr.transpose();
+	covariance.block<3, 3>(3, 3).diagonal().array() += accelVar * dt;
+	covariance.block<3, 3>(3, 6).diagonal().array() += 0.5 * accelVar * dt2;
+	covariance.block<3, 3>(6, 3).diagonal().array() += 0.5 * accelVar * dt2;
+	covariance.block<3, 3>(6, 6).diagonal().array() += 0.25 * accelVar * dt2 * dt;
+
+	// the bias jacobians also use the deltas at the start of the step
+	dp_dba += dt * dv_dba - 0.5 * dt2 * R;
+	dp_dbg += dt * dv_dbg - 0.5 * dt2 * Ra_x * dR_dbg;
+	dv_dba -= dt * R;
+	dv_dbg -= dt * Ra_x * dR_dbg;
+	dR_dbg = dRt * dR_dbg - dt * Jr;
+
+	// the deltas. position first because it uses the old velocity
+	Eigen::Vector3d a = R * alpha;
+	deltaP += dt * deltaV + 0.5 * dt2 * a;
+	deltaV += dt * a;
+	deltaR = deltaR * dq;
+	deltaR.normalize();
+
+	deltaTime += dt;
+}
+
+Eigen::Quaterniond ImuPreintegration::getDeltaRotation(const Eigen::Vector3d& dbg) const
+{
+	return deltaR * expMap(dR_dbg * dbg);
+}
+
+Eigen::Vector3d ImuPreintegration::getDeltaVelocity(const Eigen::Vector3d& dbg, const Eigen::Vector3d& dba) const
+{
+	return deltaV + dv_dbg * dbg + dv_dba * dba;
+}
+
+Eigen::Vector3d ImuPreintegration::getDeltaPosition(const Eigen::Vector3d& dbg, const Eigen::Vector3d& dba) const
+{
+	return deltaP + dp_dbg * dbg + dp_dba * dba;
+}
+
+void ImuPreintegration::predict(VIOState& x, double gravityMag) const
+{
+	Eigen::Vector3d dbg = x.vector.segment<3>(10);
+	Eigen::Vector3d dba = x.vector.segment<3>(13);
+	Eigen::Vector3d g(0, 0, -gravityMag);
+
+	Eigen::Quaterniond q = x.getQuaternion();
+	Eigen::Matrix3d R = q.toRotationMatrix();
+	Eigen::Vector3d v = x.getVelocity();
+
+	x.vector.segment<3>(0) += deltaTime * v + 0.5 * deltaTime * deltaTime * g + R * this->getDeltaPosition(dbg, dba);
+	x.setVelocity(v + deltaTime * g + R * this->getDeltaVelocity(dbg, dba));
+
+	Eigen::Quaterniond newQ = q * this->getDeltaRotation(dbg);
+	newQ.normalize();
+	x.setQuaternion(newQ);
+
+	x.setTime(ros::Time(x.getTime().toSec() + deltaTime));
+}
@@ -0,0 +1,95 @@
+/*
+ * ImuPreintegration.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_IMUPREINTEGRATION_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_IMUPREINTEGRATION_H_
+
+#include <eigen3/Eigen/Geometry>
+
+#include "VIOState.hpp"
+
+#define GYRO_NOISE_DENSITY_DEFAULT 1.7e-4 // rad/s/sqrt(Hz)
+#define ACCEL_NOISE_DENSITY_DEFAULT 2.0e-3 // m/s^2/sqrt(Hz)
+
+/*
+ * the imu readings between two times integrated on the manifold into relative deltas
+ * which do not depend on the state at the start of the interval
+ *
+ *   R_j = R_i * dR
+ *   v_j = v_i + g * dt + R_i * dv
+ *   p_j = p_i + v_i * dt + 0.5 * g * dt^2 + R_i * dp
+ *
+ * the readings are expected in the center of mass frame with the ekf's biases already removed
+ * so the deltas are linearized at a bias error of zero. a later bias error (dbg, dba) is applied
+ * with the bias jacobians as a first order correction instead of integrating again
+ *
+ * the covariance is of the delta errors [dtheta, dv, dp] where dR_true = dR * exp(dtheta)
+ */
+class ImuPreintegration
+{
+public:
+
+	ImuPreintegration();
+
+	void setNoise(double gyroNoiseDensity, double accelNoiseDensity);
+
+	/*
+	 * starts a new empty interval
+	 */
+	void reset();
+
+	/*
+	 * adds a reading which is held for dt seconds
+	 */
+	void integrate(const Eigen::Vector3d& alpha, const Eigen::Vector3d& omega, double dt);
+
+	double getDeltaTime() const {
+		return deltaTime;
+	}
+
+	/*
+	 * the deltas corrected for a bias error
+	 */
+	Eigen::Quaterniond getDeltaRotation(const Eigen::Vector3d& dbg) const;
+
+	Eigen::Vector3d getDeltaVelocity(const Eigen::Vector3d& dbg, const Eigen::Vector3d& dba) const;
+
+	Eigen::Vector3d getDeltaPosition(const Eigen::Vector3d& dbg, const Eigen::Vector3d& dba) const;
+
+	const Eigen::Matrix<double, 9, 9>& getCovariance() const {
+		return covariance;
+	}
+
+	/*
+	 * moves x to the end of the interval
+	 * x's bias estimates are used as the bias error
+	 */
+	void predict(VIOState& x, double gravityMag) const;
+
+	// the bias jacobians of the deltas
+	Eigen::Matrix3d dR_dbg;
+	Eigen::Matrix3d dv_dbg;
+	Eigen::Matrix3d dv_dba;
+	Eigen::Matrix3d dp_dbg;
+	Eigen::Matrix3d dp_dba;
+
+private:
+
+	double deltaTime;
+	Eigen::Quaterniond deltaR;
+	Eigen::Vector3d deltaV;
+	Eigen::Vector3d deltaP;
+
+	Eigen::Matrix<double, 9, 9> covariance;
+
+	double gyroNoiseDensity;
+	double accelNoiseDensity;
+};
+
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_IMUPREINTEGRATION_H_ */
@@ -0,0 +1,101 @@
+/*
+ * ImuSample.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_IMUSAMPLE_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_IMUSAMPLE_H_
+
+#include <stdint.h>
+#include <cmath>
+#include <ros/ros.h>
+#include <sensor_msgs/Imu.h>
+#include <eigen3/Eigen/Core>
+
+// sample flags
+#define IMU_SAMPLE_HAS_ACCEL 0x1 // the message had a linear acceleration
+#define IMU_SAMPLE_HAS_GYRO 0x2 // the message had an angular velocity
+#define IMU_SAMPLE_CONVERTED_TO_RAD 0x4 // the gyro was given in deg/s and converted
+
+/*
+ * one imu reading as the ekf uses it
+ *
+ * an imu message is converted into this once when it arrives. the header, orientation and
+ * covariances are dropped and the gyro is already in rad/s
+ * it is plain data (64 bytes) so the imu buffer copies it with a memcpy
+ */
+struct ImuSample
+{
+	int64_t stamp; // nanoseconds. monotonic within the imu buffer
+	double accel[3]; // m/s^2 in the imu frame
+	double gyro[3]; // rad/s in the imu frame
+	uint32_t flags;
+
+	ImuSample()
+	{
+		stamp = 0;
+		accel[0] = accel[1] = accel[2] = 0;
+		gyro[0] = gyro[1] = gyro[2] = 0;
+		flags = 0;
+	}
+
+	/*
+	 * converts the message. if convert2rad the gyro is converted from deg/s
+	 * a field whose covariance[0] is -1 was not provided by the driver (see sensor_msgs/Imu)
+	 */
+	ImuSample(const sensor_msgs::Imu& msg, bool convert2rad)
+	{
+		stamp = msg.header.stamp.toNSec();
+
+		accel[0] = msg.linear_acceleration.x;
+		accel[1] = msg.linear_acceleration.y;
+		accel[2] = msg.linear_acceleration.z;
+
+		double gyroScale = (convert2rad) ? M_PI / 180 : 1.0;
+		gyro[0] = gyroScale * msg.angular_velocity.x;
+		gyro[1] = gyroScale * msg.angular_velocity.y;
+		gyro[2] = gyroScale * msg.angular_velocity.z;
+
+		flags = 0;
+		if(msg.linear_acceleration_covariance[0] != -1)
+		{
+			flags |= IMU_SAMPLE_HAS_ACCEL;
+		}
+		if(msg.angular_velocity_covariance[0] != -1)
+		{
+			flags |= IMU_SAMPLE_HAS_GYRO;
+		}
+		if(convert2rad)
+		{
+			flags |= IMU_SAMPLE_CONVERTED_TO_RAD;
+		}
+	}
+
+	ros::Time getTime() const
+	{
+		ros::Time t;
+		t.fromNSec(stamp);
+		return t;
+	}
+
+	double toSec() const
+	{
+		return 1e-9 * stamp;
+	}
+
+	Eigen::Map<const Eigen::Vector3d> getAccel() const
+	{
+		return Eigen::Map<const Eigen::Vector3d>(accel);
+	}
+
+	Eigen::Map<const Eigen::Vector3d> getGyro() const
+	{
+		return Eigen::Map<const Eigen::Vector3d>(gyro);
+	}
+};
+
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_IMUSAMPLE_H_ */
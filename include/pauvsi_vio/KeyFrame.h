@@ -14,10 +14,26 @@ struct KeyFrame
 {
 
 	Frame* frame;
+	unsigned int generation; // the generation of the frame when it became a keyframe
 
 	KeyFrame()
 	{
 		frame = NULL;
+		generation = 0;
+	}
+
+	void setFrame(Frame* f)
+	{
+		frame = f;
+		generation = f->generation;
+	}
+
+	/*
+	 * false once the frame's slot has been reused for a newer image
+	 */
+	bool valid() const
+	{
+		return frame != NULL && frame->generation == generation;
 	}
 
 };
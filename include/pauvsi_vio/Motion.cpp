@@ -6,15 +6,16 @@
  */
 
 #include "vio.h"
+#include <eigen3/Eigen/Cholesky>
 
 void VIO::updateKeyFrameInfo() {
 
 	if (keyFrames.size() < 1) {
 		KeyFrame kf;
-		kf.frame = &this->frameBuffer.at(frameBuffer.size() / 2);
+		kf.setFrame(&this->frameBuffer.at(frameBuffer.size() / 2));
 		keyFrames.push_back(kf);
 	} else {
-		keyFrames.front().frame = &this->frameBuffer.at(frameBuffer.size() / 2);
+		keyFrames.front().setFrame(&this->frameBuffer.at(frameBuffer.size() / 2));
 	}
 }
 
@@ -44,6 +45,8 @@ VIOState VIO::transformState(VIOState x, tf::Transform trans) {
 }
 
 void VIO::twoViewBundleAdjustment(Frame& cf, KeyFrame& kf, bool structureOnly) {
+	ROS_ASSERT(kf.valid()); // the keyframe's slot must not have been reused
+
 	g2o::SparseOptimizer optimizer; // this is the g2o optimizer which ultimately solves the problem
 	optimizer.setVerbose(true); // set the verbosity of the optimizer
 
@@ -107,6 +110,72 @@ void VIO::twoViewBundleAdjustment(Frame& cf, KeyFrame& kf, bool structureOnly) {
 
 	optimizer.addVertex(cf_vertex); // add the vertex to the problem
 
+	// the imu motion between the keyframe and the current frame constrains the two camera poses
+	// the samples around the keyframe may already be evicted (see VIOEKF::evictIMUBefore)
+	// then its reading would be held across the gap so the edge is only added if the buffer still reaches back to it
+	ImuPreintegration pim;
+	if(this->ekf.imuBuffer.atOrBefore(kf.frame->state.getTime().toNSec()) != NULL &&
+			this->ekf.preintegrate(kf.frame->state, cf.timeImageCreated, pim) > 0)
+	{
+		VIOState x_imuPrediction = kf.frame->state;
+		pim.predict(x_imuPrediction, this->GRAVITY_MAG);
+		x_imuPrediction = transformState(x_imuPrediction, b2c);
+
+		// the measurement is built like the vertex estimates so the edge's error is zero at the imu prediction
+		g2o::SE3Quat predictedPose(x_imuPrediction.getQuaternion(), x_imuPrediction.getr());
+		g2o::SE3Quat keyFramePose(x_keyFrame.getQuaternion(), x_keyFrame.getr());
+
+		// [rotation, translation] blocks of the preintegrated covariance
+		const Eigen::Matrix<double, 9, 9>& pimCov = pim.getCovariance();
+		Eigen::Matrix<double, 6, 6> cov;
+		cov.topLeftCorner<3, 3>() = pimCov.topLeftCorner<3, 3>();
+		cov.topRightCorner<3, 3>() = pimCov.topRightCorner<3, 3>();
+		cov.bottomLeftCorner<3, 3>() = pimCov.bottomLeftCorner<3, 3>();
+		cov.bottomRightCorner<3, 3>() = pimCov.bottomRightCorner<3, 3>();
+
+		// the rotation error is in the current body frame but the position error is in the keyframe's body frame
+		// the edge's error is the [rotation, translation] twist of the current camera pose in its own frame
+		// so the position error is rotated into the current body frame and then both go through the adjoint of c2b
+		Eigen::Matrix3d R_bc; // rotates camera vectors into the base frame
+		for(int i = 0; i < 3; i++)
+		{
+			for(int j = 0; j < 3; j++)
+			{
+				R_bc(i, j) = b2c.getBasis()[i][j];
+			}
+		}
+		Eigen::Matrix3d R_cb = R_bc.transpose();
+		Eigen::Vector3d t_cb = -R_cb * Eigen::Vector3d(b2c.getOrigin().x(), b2c.getOrigin().y(), b2c.getOrigin().z());
+		Eigen::Matrix3d t_cb_x;
+		t_cb_x << 0, -t_cb(2), t_cb(1),
+				t_cb(2), 0, -t_cb(0),
+				-t_cb(1), t_cb(0), 0;
+		Eigen::Matrix3d dR = pim.getDeltaRotation(kf.frame->state.vector.segment<3>(10)).toRotationMatrix();
+
+		Eigen::Matrix<double, 6, 6> J = Eigen::Matrix<double, 6, 6>::Zero();
+		J.topLeftCorner<3, 3>() = R_cb;
+		J.bottomLeftCorner<3, 3>() = t_cb_x * R_cb;
+		J.bottomRightCorner<3, 3>() = R_cb * dR.transpose();
+		Eigen::Matrix<double, 6, 6> cameraCov = J * cov * J.transpose();
+
+		// a very short interval has next to no covariance so it is only used if it can be inverted
+		Eigen::LLT<Eigen::Matrix<double, 6, 6> > llt(cameraCov);
+		if(llt.info() == Eigen::Success)
+		{
+			g2o::EdgeSE3Expmap * e_imu = new g2o::EdgeSE3Expmap();
+			e_imu->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(kf_vertex));
+			e_imu->setVertex(1, dynamic_cast<g2o::OptimizableGraph::Vertex*>(cf_vertex));
+			e_imu->setMeasurement(predictedPose * keyFramePose.inverse());
+			e_imu->setInformation(llt.solve(Eigen::Matrix<double, 6, 6>::Identity()));
+
+			optimizer.addEdge(e_imu);
+		}
+		else
+		{
+			ROS_WARN("the preintegrated imu covariance is not positive definite. leaving out the imu edge");
+		}
+	}
+
 	// now the camera vertices are part of the problem
 	const int POINTS_STARTING_ID = 2;
 
@@ -117,34 +186,35 @@ void VIO::twoViewBundleAdjustment(Frame& cf, KeyFrame& kf, bool structureOnly) {
 	// setup the rest of the graph optimization problem
 	ROS_DEBUG_STREAM("features size: " << kf.frame->features.size() << " cf addr: " << &currentFrame());
 
-	for(auto& kf_ft : kf.frame->features)
+	for(int i = 0; i < kf.frame->features.size(); i++)
 	{
+		Point* kf_pt = kf.frame->features.point.at(i);
 		//check if the 3d point is still being tracked
 
-		if(kf_ft.point != NULL)
+		if(kf_pt != NULL)
 		{
 			ROS_DEBUG_STREAM("point ID : " << point_id);
-			ROS_DEBUG_STREAM("point address: " << kf_ft.point << " point init: " << kf_ft.point->initialized());
-			ROS_DEBUG_STREAM("newest feature's frame index " << kf_ft.point->observations.front()->frame);
+			ROS_DEBUG_STREAM("point address: " << kf_pt << " point init: " << kf_pt->initialized());
+			ROS_DEBUG_STREAM("newest feature's frame index " << kf_pt->observations.front().frame);
 
 			g2o::VertexSBAPointXYZ * v_p = new g2o::VertexSBAPointXYZ(); // create a vertex for this 3d point
 
 			v_p->setId(point_id); // set the vertex's id
 			v_p->setMarginalized(true);
-			v_p->setEstimate(kf_ft.point->getWorldCoordinate()); // set the initial estimate
+			v_p->setEstimate(kf_pt->getWorldCoordinate()); // set the initial estimate
 
 			number_of_points++;
 
 			optimizer.addVertex(v_p); // add this point to the problem
 			ROS_DEBUG_STREAM("added this 3d point: " << v_p->estimate() << " with dimension " << v_p->Dimension);
-			ROS_DEBUG_STREAM("supposed to be " << kf_ft.point->getWorldCoordinate());
+			ROS_DEBUG_STREAM("supposed to be " << kf_pt->getWorldCoordinate());
 
 			// now we must set up the edges between these three vertices
 			g2o::EdgeProjectXYZ2UV * e1 = new g2o::EdgeProjectXYZ2UV(); // here is the first edge
 
 			e1->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(v_p)); // set the 3d point
 			e1->setVertex(1, dynamic_cast<g2o::OptimizableGraph::Vertex*>(kf_vertex)); // set the camera
-			e1->setMeasurement(kf_ft.getUndistortedMeasurement()); //[u, v]
+			e1->setMeasurement(kf.frame->features.getUndistortedMeasurement(i)); //[u, v]
 			e1->setParameterId(0, 0); // set this edge to the camera params
 
 			if(ROBUST_HUBER)
@@ -161,7 +231,7 @@ void VIO::twoViewBundleAdjustment(Frame& cf, KeyFrame& kf, bool structureOnly) {
 			e2->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(v_p)); // set the 3d point
 			e2->setVertex(1, dynamic_cast<g2o::OptimizableGraph::Vertex*>(cf_vertex)); // set the camera
 			// get the corresponding 2d feature linked to this 3d point in the current frame
-			e2->setMeasurement(kf_ft.point->observations.front()->getUndistortedMeasurement()); //[u, v]
+			e2->setMeasurement(kf_pt->observations.front().getUndistortedMeasurement()); //[u, v]
 			e2->setParameterId(0, 0); // using the camera params
 
 			if(ROBUST_HUBER)
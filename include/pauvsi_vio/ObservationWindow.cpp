@@ -0,0 +1,49 @@
+/*
+ * ObservationWindow.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "ObservationWindow.h"
+
+ObservationWindow::ObservationWindow(int capacity)
+{
+	head = 0;
+	count = 0;
+	this->reset(capacity);
+}
+
+void ObservationWindow::reset(int capacity)
+{
+	ROS_ASSERT(capacity >= 2); // the flow needs the current and the last observation
+	if(capacity != buffer.size())
+	{
+		buffer.resize(capacity);
+	}
+	head = 0;
+	count = 0;
+}
+
+void ObservationWindow::push_front(const FeatureRef& ft)
+{
+	head = (head + buffer.size() - 1) % buffer.size();
+	buffer[head] = ft; // overwrites the oldest observation if full
+
+	if(count < buffer.size())
+	{
+		count++;
+	}
+
+	this->compact();
+}
+
+int ObservationWindow::compact()
+{
+	while(count > 0 && !this->back().valid())
+	{
+		count--;
+	}
+
+	return count;
+}
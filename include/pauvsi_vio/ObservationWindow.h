@@ -0,0 +1,90 @@
+/*
+ * ObservationWindow.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_OBSERVATIONWINDOW_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_OBSERVATIONWINDOW_H_
+
+#include <vector>
+#include <ros/ros.h>
+
+#include "FeatureStore.h"
+
+#define DEFAULT_OBSERVATION_WINDOW 20
+
+/*
+ * the last n observations of a point. the newest is at index 0
+ *
+ * this is a fixed capacity ring so a point's memory is bounded no matter how long it is tracked
+ * when it is full the oldest observation is dropped
+ *
+ * frames are evicted oldest first so the observations into evicted frames are always at the back
+ * they are dropped every time an observation is added or compact() is called
+ */
+class ObservationWindow
+{
+public:
+
+	ObservationWindow(int capacity = DEFAULT_OBSERVATION_WINDOW);
+
+	/*
+	 * changes the capacity and drops all observations
+	 * only allocates if the capacity changed
+	 */
+	void reset(int capacity);
+
+	/*
+	 * adds the newest observation
+	 * drops the oldest one if full and then all observations into evicted frames
+	 */
+	void push_front(const FeatureRef& ft);
+
+	/*
+	 * drops the observations into evicted frames
+	 * afterwards every observation is valid
+	 * returns the number of observations left
+	 */
+	int compact();
+
+	void clear(){
+		count = 0;
+	}
+
+	const FeatureRef& at(int i) const {
+		ROS_ASSERT(i >= 0 && i < count);
+		return buffer[(head + i) % buffer.size()];
+	}
+
+	const FeatureRef& front() const {
+		return this->at(0);
+	}
+
+	const FeatureRef& back() const {
+		return this->at(count - 1);
+	}
+
+	int size() const {
+		return count;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	int capacity() const {
+		return buffer.size();
+	}
+
+private:
+
+	std::vector<FeatureRef> buffer;
+	int head; // the index of the newest observation in the buffer
+	int count;
+};
+
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_OBSERVATIONWINDOW_H_ */
@@ -0,0 +1,89 @@
+/*
+ * OdometrySmoother.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "OdometrySmoother.h"
+
+OdometrySmoother::OdometrySmoother()
+{
+	this->tau = ODOMETRY_SMOOTHING_TIME_DEFAULT;
+	this->reset();
+}
+
+void OdometrySmoother::setSmoothingTime(double tau)
+{
+	this->tau = tau;
+	if(tau <= 0)
+	{
+		this->reset();
+	}
+}
+
+void OdometrySmoother::reset()
+{
+	dp.setZero();
+	dv.setZero();
+	dtheta.setZero();
+	timeSet = false;
+}
+
+/*
+ * the output was before with the offset applied. the new offset is the difference between that and after
+ */
+void OdometrySmoother::correct(const VIOState& before, const VIOState& after)
+{
+	if(this->tau <= 0)
+	{
+		return;
+	}
+
+	dp += before.vector.segment<3>(0) - after.vector.segment<3>(0);
+	dv += before.vector.segment<3>(3) - after.vector.segment<3>(3);
+
+	Eigen::Quaterniond qb(before.q0(), before.q1(), before.q2(), before.q3());
+	Eigen::Quaterniond qa(after.q0(), after.q1(), after.q2(), after.q3());
+
+	double angle = dtheta.norm();
+	Eigen::Quaterniond qOut = (angle > 0) ? Eigen::Quaterniond(Eigen::AngleAxisd(angle, dtheta / angle)) * qb : qb;
+
+	Eigen::AngleAxisd aa(qOut * qa.conjugate());
+	if(aa.angle() > M_PI)
+	{
+		aa.angle() -= 2 * M_PI; // take the short way around
+	}
+	dtheta = aa.angle() * aa.axis();
+}
+
+void OdometrySmoother::apply(const VIOState& x, VIOState& out)
+{
+	out = x;
+
+	// decay the offset over the time since the last output
+	if(this->timeSet && this->tau > 0)
+	{
+		double dt = x.getTime().toSec() - this->lastApplied.toSec();
+		if(dt > 0)
+		{
+			double decay = exp(-dt / this->tau);
+			dp *= decay;
+			dv *= decay;
+			dtheta *= decay;
+		}
+	}
+	this->lastApplied = x.getTime();
+	this->timeSet = true;
+
+	out.vector.segment<3>(0) += dp;
+	out.vector.segment<3>(3) += dv;
+
+	double angle = dtheta.norm();
+	if(angle > 0)
+	{
+		Eigen::Quaterniond q = Eigen::Quaterniond(Eigen::AngleAxisd(angle, dtheta / angle)) * Eigen::Quaterniond(x.q0(), x.q1(), x.q2(), x.q3());
+		q.normalize();
+		out.setQuaternion(q);
+	}
+}
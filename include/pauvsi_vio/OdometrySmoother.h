@@ -0,0 +1,66 @@
+/*
+ * OdometrySmoother.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_ODOMETRYSMOOTHER_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_ODOMETRYSMOOTHER_H_
+
+#include <ros/ros.h>
+#include <eigen3/Eigen/Geometry>
+
+#include "VIOState.hpp"
+
+#define ODOMETRY_SMOOTHING_TIME_DEFAULT 0.1
+
+/*
+ * hides the jumps of the running state from the imu rate odometry output
+ *
+ * when a visual update moves the running state the difference between the old and new state
+ * is kept as an offset on the output. the offset decays to zero with the smoothing time constant
+ * so the output moves over to the corrected estimate instead of jumping
+ *
+ * only the position, velocity and orientation are smoothed. the covariance is passed through
+ * it is not synchronized. the owner locks around it
+ */
+class OdometrySmoother
+{
+public:
+
+	OdometrySmoother();
+
+	/*
+	 * the time constant of the decay in seconds. if it is not positive corrections are not smoothed
+	 */
+	void setSmoothingTime(double tau);
+
+	/*
+	 * the running state moved from before to after
+	 * the offset is changed so the output stays where it was
+	 */
+	void correct(const VIOState& before, const VIOState& after);
+
+	/*
+	 * decays the offset to x's time and writes x with the offset applied into out
+	 */
+	void apply(const VIOState& x, VIOState& out);
+
+	void reset();
+
+private:
+
+	double tau;
+
+	Eigen::Vector3d dp; // position offset
+	Eigen::Vector3d dv; // velocity offset
+	Eigen::Vector3d dtheta; // world frame small angle offset. q_out = exp(dtheta) * q
+
+	ros::Time lastApplied;
+	bool timeSet;
+};
+
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_ODOMETRYSMOOTHER_H_ */
@@ -7,27 +7,28 @@
 
 
 #include "Point.h"
+#include "PointPool.h"
 
 Point::Point()
 {
 	sigma = 1000; // starting depth certainty
-	this->theMap == NULL;
+	this->pool = NULL;
 	_initialized = false;
 }
 
-Point::Point(Feature* ft){
+Point::Point(FeatureRef ft){
 	observations.push_front(ft); // add this observation to the deque
 	sigma = 1000; // starting depth certainty
-	this->theMap == NULL;
+	this->pool = NULL;
 	_initialized = false;
 }
 
-void Point::addObservation(Feature* ft)
+void Point::addObservation(FeatureRef ft)
 {
 	/*
 	if(observations.size() >= 1)
 	{
-		ROS_DEBUG_STREAM("this feature frame " << ft->frame << " last frame: " << observations.at(0)->frame);
+		ROS_DEBUG_STREAM("this feature frame " << ft.frame << " last frame: " << observations.at(0).frame);
 	}*/
 
 	observations.push_front(ft);
@@ -35,7 +36,7 @@ void Point::addObservation(Feature* ft)
 	/*
 	if(observations.size() > 1)
 	{
-		ROS_DEBUG_STREAM("*most recent obs frame: " << observations.front()->frame << " last obs frame: " << observations.back()->frame);
+		ROS_DEBUG_STREAM("*most recent obs frame: " << observations.front().frame << " last obs frame: " << observations.back().frame);
 	}*/
 }
 
@@ -61,9 +62,9 @@ Eigen::Vector3d Point::getWorldCoordinate()
 /*
  * please give the transform from camera coord to world coord
  */
-void Point::initializePoint(tf::Transform transform, Feature* ft, double start_depth, double start_sigma)
+void Point::initializePoint(tf::Transform transform, const FeatureRef& ft, double start_depth, double start_sigma)
 {
-	Eigen::Vector3d eig_dir = (start_depth * ft->getDirectionVector());
+	Eigen::Vector3d eig_dir = (start_depth * ft.getDirectionVector());
 	tf::Vector3 dir_vec = tf::Vector3(eig_dir(0), eig_dir(1), eig_dir(2));
 	tf::Vector3 world_point = transform * dir_vec;
 
@@ -78,17 +79,24 @@ void Point::initializePoint(tf::Transform transform, Feature* ft, double start_d
 
 void Point::safelyDelete(){
 	//first nullify all references to me
-	ROS_ASSERT(this->thisPoint->pos == this->pos);
-	for(auto& e : this->observations)
+	ROS_ASSERT(this->pool != NULL && this->pool->get(this->handle) == this);
+	for(int i = 0; i < this->observations.size(); i++)
 	{
-		e->point = NULL;
-		e->pointLost = true;
+		this->observations.at(i).setPointLost(); // does nothing for observations into evicted frames
 	}
 
 	ROS_DEBUG_STREAM("point deleting itself");
 
 	//peace out delete my self
 	// we had a good run
-	this->theMap->erase(this->thisPoint);
+	this->pool->erase(this->handle);
 	ROS_DEBUG_STREAM("I deleted myself");
 }
+
+void Point::reset(FeatureRef ft, int observationWindow)
+{
+	observations.reset(observationWindow);
+	observations.push_front(ft);
+	sigma = 1000; // starting depth certainty
+	_initialized = false;
+}
@@ -11,32 +11,63 @@
 #include <eigen3/Eigen/Geometry>
 
 #include "Feature.h"
+#include "FeatureStore.h"
+#include "ObservationWindow.h"
 
 class Feature;
 
+class PointPool;
+
+/*
+ * a handle to a point in the pool
+ * the generation of a slot is incremented every time its point is erased
+ * so a handle to an erased point never resolves to the point which reuses its slot
+ */
+struct PointHandle
+{
+	int index;
+	unsigned int generation;
+
+	PointHandle()
+	{
+		index = -1;
+		generation = 0;
+	}
+
+	PointHandle(int _index, unsigned int _generation)
+	{
+		index = _index;
+		generation = _generation;
+	}
+
+	bool operator==(const PointHandle& other) const {
+		return index == other.index && generation == other.generation;
+	}
+};
+
 class Point{
 
 public:
 
-	std::list<Point>::iterator thisPoint; // the iterator of this point in the map
-	std::list<Point>* theMap; // a pointer to the map which this point is stored in
+	PointHandle handle; // the handle of this point in the pool
+	PointPool* pool; // a pointer to the pool which this point is stored in
 
-	std::deque<Feature*> observations; // this is  a list of observations of this 3d point from different frames
+	ObservationWindow observations; // the last observations of this 3d point from different frames. the newest is at the front
 
 	Eigen::Vector3d pos; // this is the world coordinate of the point
 	double sigma; // the variance of the point's depth
 
 	Point();
 
-	Point(Feature* ft);
+	Point(FeatureRef ft);
 
-	void addObservation(Feature* ft);
+	void addObservation(FeatureRef ft);
 
 	void update(Eigen::Vector3d z, double variance);
 
 	Eigen::Vector3d getWorldCoordinate();
 
-	void initializePoint(tf::Transform transform, Feature* ft, double start_depth, double start_sigma);
+	void initializePoint(tf::Transform transform, const FeatureRef& ft, double start_depth, double start_sigma);
 
 	bool initialized(){
 		return _initialized;
@@ -44,6 +75,12 @@ public:
 
 	void safelyDelete();
 
+	/*
+	 * clears this point so its slot can be reused for a new point observed by ft
+	 * the observation window keeps its memory unless its size changes
+	 */
+	void reset(FeatureRef ft, int observationWindow = DEFAULT_OBSERVATION_WINDOW);
+
 private:
 
 	bool _initialized;
@@ -0,0 +1,85 @@
+/*
+ * PointPool.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "PointPool.h"
+
+PointPool::PointPool(int chunkSize)
+{
+	ROS_ASSERT(chunkSize > 0);
+	this->chunkSize = chunkSize;
+	this->count = 0;
+	this->observationWindow = DEFAULT_OBSERVATION_WINDOW;
+}
+
+void PointPool::setObservationWindow(int window)
+{
+	this->observationWindow = window;
+}
+
+/*
+ * adds a chunk of free slots
+ * the free slots are pushed in reverse so the lowest slot is used first
+ */
+void PointPool::addChunk()
+{
+	int first = this->slots();
+
+	chunks.push_back(std::vector<Point>(chunkSize));
+	generation.resize(first + chunkSize, 0);
+	alive.resize(first + chunkSize, false);
+
+	for(int i = first + chunkSize - 1; i >= first; i--)
+	{
+		freeSlots.push_back(i);
+	}
+}
+
+Point* PointPool::insert(const FeatureRef& ft)
+{
+	if(freeSlots.empty())
+	{
+		this->addChunk();
+	}
+
+	int slot = freeSlots.back();
+	freeSlots.pop_back();
+
+	Point* pt = &this->at(slot);
+	pt->reset(ft, this->observationWindow);
+	pt->pool = this;
+	pt->handle = PointHandle(slot, generation[slot]);
+
+	alive[slot] = true;
+	count++;
+
+	return pt;
+}
+
+bool PointPool::erase(PointHandle handle)
+{
+	if(this->get(handle) == NULL)
+	{
+		return false;
+	}
+
+	alive[handle.index] = false;
+	generation[handle.index]++; // invalidate all handles to this point
+	freeSlots.push_back(handle.index);
+	count--;
+
+	return true;
+}
+
+Point* PointPool::get(PointHandle handle)
+{
+	if(handle.index < 0 || handle.index >= this->slots() || !alive[handle.index] || generation[handle.index] != handle.generation)
+	{
+		return NULL;
+	}
+
+	return &this->at(handle.index);
+}
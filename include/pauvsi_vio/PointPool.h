@@ -0,0 +1,145 @@
+/*
+ * PointPool.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_POINTPOOL_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_POINTPOOL_H_
+
+#include <vector>
+#include <iterator>
+#include <ros/ros.h>
+
+#include "Point.h"
+#include "FeatureStore.h"
+
+#define POINT_POOL_CHUNK_SIZE 256
+
+/*
+ * a pooled store of all active 3d points
+ *
+ * points live in fixed size chunks which are never reallocated
+ * so a point never moves and Point* stays valid until the point is erased
+ * erased slots are put on a free list and reused by the next insert
+ *
+ * insert and erase are O(1) and only allocate when a new chunk is needed
+ * iteration walks the chunks in order and skips the free slots
+ */
+class PointPool
+{
+public:
+
+	class iterator : public std::iterator<std::forward_iterator_tag, Point>
+	{
+	public:
+		iterator(PointPool* _pool, int _slot) : pool(_pool), slot(_slot) {
+			skipFree();
+		}
+
+		Point& operator*() const {
+			return pool->at(slot);
+		}
+
+		Point* operator->() const {
+			return &pool->at(slot);
+		}
+
+		iterator& operator++() {
+			slot++;
+			skipFree();
+			return *this;
+		}
+
+		bool operator==(const iterator& other) const {
+			return slot == other.slot;
+		}
+
+		bool operator!=(const iterator& other) const {
+			return slot != other.slot;
+		}
+
+	private:
+		PointPool* pool;
+		int slot;
+
+		void skipFree() {
+			while(slot < pool->slots() && !pool->alive[slot])
+			{
+				slot++;
+			}
+		}
+	};
+
+	PointPool(int chunkSize = POINT_POOL_CHUNK_SIZE);
+
+	/*
+	 * sets the number of observations each new point keeps
+	 */
+	void setObservationWindow(int window);
+
+	/*
+	 * creates a new point observed by this feature
+	 * it is linked to the pool and its handle is set
+	 */
+	Point* insert(const FeatureRef& ft);
+
+	/*
+	 * erases the point if the handle is still valid
+	 * returns false if it was already erased
+	 */
+	bool erase(PointHandle handle);
+
+	/*
+	 * gets the point or NULL if it has been erased
+	 */
+	Point* get(PointHandle handle);
+
+	/*
+	 * the number of live points
+	 */
+	int size() const {
+		return count;
+	}
+
+	/*
+	 * the number of slots in all chunks
+	 */
+	int capacity() const {
+		return chunks.size() * chunkSize;
+	}
+
+	iterator begin() {
+		return iterator(this, 0);
+	}
+
+	iterator end() {
+		return iterator(this, this->slots());
+	}
+
+private:
+
+	int chunkSize;
+	int count;
+	int observationWindow;
+
+	std::vector<std::vector<Point> > chunks; // the inner vectors are never resized so points never move
+	std::vector<unsigned int> generation; // per slot
+	std::vector<uchar> alive; // per slot
+	std::vector<int> freeSlots;
+
+	int slots() const {
+		return alive.size();
+	}
+
+	Point& at(int slot) {
+		return chunks[slot / chunkSize][slot % chunkSize];
+	}
+
+	void addChunk();
+};
+
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_POINTPOOL_H_ */
@@ -0,0 +1,117 @@
+/*
+ * ROIMask.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "ROIMask.h"
+
+// the spans are kept this many pixels away from the circle so float rounding can never put a pixel on the wrong side
+#define ROI_SPAN_MARGIN 0.01
+
+ROIMask::ROIMask()
+{
+	killRadius = -1;
+}
+
+ROIMask::ROIMask(int width, int height, float kill_radius)
+{
+	this->killRadius = kill_radius;
+	this->center = cv::Point2f((float)(width / 2), (float)(height / 2)); // same center as the frame uses
+
+	this->mask = cv::Mat::zeros(height, width, CV_8U);
+	this->radius = cv::Mat(height, width, CV_32F);
+
+	int minX = width, minY = height, maxX = -1, maxY = -1;
+	for(int y = 0; y < height; y++)
+	{
+		uchar* maskRow = this->mask.ptr<uchar>(y);
+		float* radiusRow = this->radius.ptr<float>(y);
+		for(int x = 0; x < width; x++)
+		{
+			radiusRow[x] = this->computeRadius(cv::Point2f(x, y));
+			if(radiusRow[x] <= kill_radius)
+			{
+				maskRow[x] = 255;
+				minX = std::min(minX, x);
+				maxX = std::max(maxX, x);
+				minY = std::min(minY, y);
+				maxY = std::max(maxY, y);
+			}
+		}
+	}
+
+	this->bounds = (maxX >= 0) ? cv::Rect(minX, minY, maxX - minX + 1, maxY - minY + 1) : cv::Rect();
+
+	// build the row spans for sub pixel checks
+	double r2 = (double)kill_radius * kill_radius;
+	double eps = 2 * std::max((double)kill_radius, 1.0) * ROI_SPAN_MARGIN; // the margin in squared pixels
+	innerHalfWidth.resize(height);
+	outerHalfWidth.resize(height);
+	for(int y = 0; y < height; y++)
+	{
+		double dyNear = 0; // the closest any y in [y, y + 1) gets to the center row
+		if(y > center.y)
+		{
+			dyNear = y - center.y;
+		}
+		else if(y + 1 < center.y)
+		{
+			dyNear = center.y - (y + 1);
+		}
+		double dyFar = std::max(std::abs(y - center.y), std::abs(y + 1 - center.y));
+
+		innerHalfWidth.at(y) = (dyFar * dyFar < r2 - eps) ? (float)sqrt(r2 - eps - dyFar * dyFar) : -1;
+		outerHalfWidth.at(y) = (float)sqrt(std::max(r2 + eps - dyNear * dyNear, 0.0));
+	}
+}
+
+/*
+ * checks if a (sub)pixel is within the kill radius
+ * only pixels in the thin band around the circle's edge fall back to the exact radius
+ */
+bool ROIMask::contains(cv::Point2f px) const
+{
+	// rows outside of the image have no table
+	if(px.y >= 0 && px.y < innerHalfWidth.size())
+	{
+		int row = (int)px.y;
+		float dx = std::abs(px.x - center.x);
+		if(dx <= innerHalfWidth[row])
+		{
+			return true;
+		}
+		if(dx > outerHalfWidth[row])
+		{
+			return false;
+		}
+	}
+
+	return this->computeRadius(px) <= killRadius;
+}
+
+/*
+ * gets the radius of a pixel from the image center
+ * integer pixels are looked up, all others are computed
+ */
+float ROIMask::radiusAt(cv::Point2f px) const
+{
+	int x = (int)px.x;
+	int y = (int)px.y;
+	if(x == px.x && y == px.y && x >= 0 && y >= 0 && x < radius.cols && y < radius.rows)
+	{
+		return radius.at<float>(y, x);
+	}
+	return this->computeRadius(px);
+}
+
+/*
+ * the exact radius. the same math as Frame::getAndSetFeatureRadius
+ */
+float ROIMask::computeRadius(cv::Point2f px) const
+{
+	float dx = px.x - center.x;
+	float dy = px.y - center.y;
+	return (sqrt(dx * dx + dy * dy));
+}
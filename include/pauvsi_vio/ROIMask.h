@@ -0,0 +1,72 @@
+/*
+ * ROIMask.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_ROIMASK_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_ROIMASK_H_
+
+#include "opencv2/core/core.hpp"
+#include <vector>
+
+/*
+ * the circular region of interest around the image center which features must stay in
+ * this is built once per image size and kill radius and holds:
+ * a detection mask for FAST
+ * the radius of every pixel
+ * a per row table of the x spans which are definitely inside/outside the circle
+ *
+ * every decision made with this mask is the same as computing
+ * sqrt(dx * dx + dy * dy) <= kill_radius like Frame::getAndSetFeatureRadius does
+ */
+class ROIMask
+{
+public:
+
+	cv::Mat mask; // CV_8U 255 inside the kill radius 0 outside
+	cv::Mat radius; // CV_32F the radius of each pixel from the image center
+	cv::Rect bounds; // the bounding box of all pixels inside the kill radius
+
+	ROIMask();
+
+	ROIMask(int width, int height, float kill_radius);
+
+	bool matches(int width, int height, float kill_radius) const {
+		return width == mask.cols && height == mask.rows && kill_radius == killRadius;
+	}
+
+	/*
+	 * checks if a (sub)pixel is within the kill radius
+	 * only pixels in the thin band around the circle's edge fall back to the exact radius
+	 */
+	bool contains(cv::Point2f px) const;
+
+	/*
+	 * gets the radius of a pixel from the image center
+	 * integer pixels are looked up, all others are computed
+	 */
+	float radiusAt(cv::Point2f px) const;
+
+	/*
+	 * the exact radius. the same math as Frame::getAndSetFeatureRadius
+	 */
+	float computeRadius(cv::Point2f px) const;
+
+	cv::Point2f getCenter() const {
+		return center;
+	}
+
+private:
+
+	float killRadius;
+	cv::Point2f center;
+
+	// for each row r, any pixel with y in [r, r+1) and |x - center.x| <= innerHalfWidth[r] is inside
+	// and any pixel with |x - center.x| > outerHalfWidth[r] is outside
+	std::vector<float> innerHalfWidth;
+	std::vector<float> outerHalfWidth;
+};
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_ROIMASK_H_ */
@@ -0,0 +1,88 @@
+/*
+ * StateHistory.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "StateHistory.h"
+
+StateHistory::StateHistory()
+{
+	head = 0;
+	count = 0;
+}
+
+void StateHistory::allocate(int capacity)
+{
+	ROS_ASSERT(capacity >= 1);
+	slots.resize(capacity);
+	stamps.resize(capacity);
+	this->clear();
+}
+
+void StateHistory::push(const VIOState& x)
+{
+	ROS_ASSERT(!slots.empty());
+	int64_t stamp = x.getTime().toNSec();
+	ROS_ASSERT(count == 0 || stamp >= stamps[this->slot(count - 1)]);
+
+	if(count == (int)slots.size())
+	{
+		head = this->slot(1); // drop the oldest
+		count--;
+	}
+
+	int s = this->slot(count);
+	slots[s] = x;
+	stamps[s] = stamp;
+	count++;
+}
+
+VIOState& StateHistory::back()
+{
+	ROS_ASSERT(count > 0);
+	return slots[this->slot(count - 1)];
+}
+
+const VIOState* StateHistory::atOrBefore(ros::Time t) const
+{
+	int i = this->search(t.toNSec());
+	if(i < 0)
+	{
+		return NULL;
+	}
+
+	return &slots[this->slot(i)];
+}
+
+void StateHistory::dropBefore(ros::Time t)
+{
+	int i = this->search(t.toNSec());
+	if(i > 0)
+	{
+		head = this->slot(i);
+		count -= i;
+	}
+}
+
+int StateHistory::search(int64_t t) const
+{
+	// the first index with a stamp after t
+	int begin = 0;
+	int end = count;
+	while(begin < end)
+	{
+		int mid = begin + (end - begin) / 2;
+		if(stamps[this->slot(mid)] <= t)
+		{
+			begin = mid + 1;
+		}
+		else
+		{
+			end = mid;
+		}
+	}
+
+	return begin - 1;
+}
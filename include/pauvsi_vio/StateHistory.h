@@ -0,0 +1,87 @@
+/*
+ * StateHistory.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_STATEHISTORY_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_STATEHISTORY_H_
+
+#include <vector>
+#include <stdint.h>
+#include <ros/ros.h>
+
+#include "VIOState.hpp"
+
+#define STATE_HISTORY_LENGTH_DEFAULT 512
+
+/*
+ * a fixed capacity ring of propagated states ordered by time. the newest state is back()
+ *
+ * every slot is allocated once in allocate() and overwritten when the oldest state is dropped
+ * lookups by time are a binary search over the stamps
+ * it is not synchronized. the owner locks around it
+ */
+class StateHistory
+{
+public:
+
+	StateHistory();
+
+	void allocate(int capacity);
+
+	/*
+	 * appends a copy of x. the oldest state is dropped if the ring is full
+	 * x must not be older than back()
+	 */
+	void push(const VIOState& x);
+
+	void clear() {
+		head = 0;
+		count = 0;
+	}
+
+	int size() const {
+		return count;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	/*
+	 * the newest state
+	 */
+	VIOState& back();
+
+	/*
+	 * the newest state at or before t. NULL if t is before the oldest state
+	 */
+	const VIOState* atOrBefore(ros::Time t) const;
+
+	/*
+	 * drops every state older than the newest state at or before t
+	 */
+	void dropBefore(ros::Time t);
+
+private:
+
+	std::vector<VIOState> slots;
+	std::vector<int64_t> stamps;
+	int head; // the slot of the oldest state
+	int count;
+
+	/*
+	 * the index (0 is the oldest) of the newest state at or before t. -1 if there is none
+	 */
+	int search(int64_t t) const;
+
+	int slot(int i) const {
+		return (head + i) % slots.size();
+	}
+};
+
+
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_STATEHISTORY_H_ */
@@ -0,0 +1,180 @@
+/*
+ * UndistortionMap.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#include "UndistortionMap.h"
+
+UndistortionMap::UndistortionMap()
+{
+	step = 0;
+	cols = 0;
+	rows = 0;
+	maxError = 0;
+}
+
+UndistortionMap::UndistortionMap(cv::Mat K, cv::Mat D, cv::Size size, double max_error)
+{
+	// copy the matrices because they can share data with a camera info message
+	this->K = K.clone();
+	this->D = D.clone();
+	this->size = size;
+
+	// refine the grid until it is accurate enough
+	int s = UNDISTORTION_MAP_START_STEP;
+	for(;;)
+	{
+		this->build(s);
+		this->maxError = this->measureError();
+		if(this->maxError <= max_error || s == 1)
+		{
+			break;
+		}
+		s /= 2;
+	}
+
+	ROS_DEBUG_STREAM("built undistortion map with a step of " << step << " and a max error of " << maxError << " pixels");
+	ROS_WARN_COND(maxError > max_error, "the undistortion map could not reach the max error");
+}
+
+static bool sameMat(const cv::Mat& a, const cv::Mat& b)
+{
+	return a.size() == b.size() && a.type() == b.type() && (a.empty() || cv::norm(a, b, cv::NORM_INF) == 0);
+}
+
+bool UndistortionMap::matches(cv::Mat K, cv::Mat D, cv::Size size) const
+{
+	return !this->empty() && size == this->size && sameMat(K, this->K) && sameMat(D, this->D);
+}
+
+/*
+ * undistorts a single pixel
+ */
+cv::Point2f UndistortionMap::undistort(cv::Point2f px) const
+{
+	if(this->inGrid(px))
+	{
+		return this->interpolate(px);
+	}
+
+	std::vector<cv::Point2f> in(1, px);
+	std::vector<cv::Point2f> out;
+	cv::fisheye::undistortPoints(in, out, K, D);
+	return out.at(0);
+}
+
+/*
+ * undistorts a batch of pixels
+ * all pixels outside of the grid are undistorted exactly with one call
+ */
+void UndistortionMap::undistort(const std::vector<cv::Point2f>& in, std::vector<cv::Point2f>& out) const
+{
+	out.resize(in.size());
+
+	std::vector<int> outsideIndexes;
+	std::vector<cv::Point2f> outside;
+	for(int i = 0; i < in.size(); i++)
+	{
+		if(this->inGrid(in[i]))
+		{
+			out[i] = this->interpolate(in[i]);
+		}
+		else
+		{
+			outsideIndexes.push_back(i);
+			outside.push_back(in[i]);
+		}
+	}
+
+	if(!outside.empty())
+	{
+		std::vector<cv::Point2f> exact;
+		cv::fisheye::undistortPoints(outside, exact, K, D);
+		for(int i = 0; i < outsideIndexes.size(); i++)
+		{
+			out[outsideIndexes[i]] = exact[i];
+		}
+	}
+}
+
+void UndistortionMap::build(int step)
+{
+	this->step = step;
+	this->cols = std::max((size.width - 1 + step - 1) / step + 1, 2); // the last node is at or past the last pixel
+	this->rows = std::max((size.height - 1 + step - 1) / step + 1, 2);
+
+	std::vector<cv::Point2f> in;
+	in.reserve(cols * rows);
+	for(int r = 0; r < rows; r++)
+	{
+		for(int c = 0; c < cols; c++)
+		{
+			in.push_back(cv::Point2f(c * step, r * step));
+		}
+	}
+
+	cv::fisheye::undistortPoints(in, nodes, K, D);
+}
+
+/*
+ * compares the interpolation at the center of each cell with the exact undistortion
+ * the center is the farthest point from the nodes so it has the largest error
+ * returns the error in pixels
+ */
+double UndistortionMap::measureError() const
+{
+	std::vector<cv::Point2f> centers;
+	for(int r = 0; r < rows - 1; r++)
+	{
+		for(int c = 0; c < cols - 1; c++)
+		{
+			centers.push_back(cv::Point2f((c + 0.5) * step, (r + 0.5) * step));
+		}
+	}
+
+	if(centers.empty())
+	{
+		return 0;
+	}
+
+	std::vector<cv::Point2f> exact;
+	cv::fisheye::undistortPoints(centers, exact, K, D);
+
+	// convert from normalized coordinates to pixels with the focal lengths
+	cv::Mat K64;
+	K.convertTo(K64, CV_64F);
+	double fx = K64.at<double>(0, 0);
+	double fy = K64.at<double>(1, 1);
+
+	double worst = 0;
+	for(int i = 0; i < centers.size(); i++)
+	{
+		cv::Point2f approx = this->interpolate(centers[i]);
+		double ex = fx * (approx.x - exact[i].x);
+		double ey = fy * (approx.y - exact[i].y);
+		worst = std::max(worst, sqrt(ex * ex + ey * ey));
+	}
+
+	return worst;
+}
+
+cv::Point2f UndistortionMap::interpolate(cv::Point2f px) const
+{
+	float gx = px.x / step;
+	float gy = px.y / step;
+	int c = std::min((int)gx, cols - 2);
+	int r = std::min((int)gy, rows - 2);
+	float ax = gx - c;
+	float ay = gy - r;
+
+	const cv::Point2f& n00 = nodes[r * cols + c];
+	const cv::Point2f& n01 = nodes[r * cols + c + 1];
+	const cv::Point2f& n10 = nodes[(r + 1) * cols + c];
+	const cv::Point2f& n11 = nodes[(r + 1) * cols + c + 1];
+
+	cv::Point2f top = n00 + ax * (n01 - n00);
+	cv::Point2f bottom = n10 + ax * (n11 - n10);
+	return top + ay * (bottom - top);
+}
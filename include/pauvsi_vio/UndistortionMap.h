@@ -0,0 +1,92 @@
+/*
+ * UndistortionMap.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: pauvsi
+ */
+
+#ifndef PAUVSI_VIO_INCLUDE_PAUVSI_VIO_UNDISTORTIONMAP_H_
+#define PAUVSI_VIO_INCLUDE_PAUVSI_VIO_UNDISTORTIONMAP_H_
+
+#include "opencv2/core/core.hpp"
+#include <opencv2/calib3d.hpp>
+#include <vector>
+#include <ros/ros.h>
+
+#define UNDISTORTION_MAP_START_STEP 16 // pixels between grid nodes before refinement
+#define UNDISTORTION_MAP_MAX_ERROR 0.01 // the largest allowed interpolation error in pixels
+
+/*
+ * a lookup grid of the exact fisheye undistortion of every step'th pixel
+ * any pixel inside the grid is undistorted by bilinear interpolation of the four nodes around it
+ * pixels outside of the grid fall back to cv::fisheye::undistortPoints
+ *
+ * when the map is built the error is measured against cv::fisheye::undistortPoints at the center
+ * of every cell and the step is halved until it is below the max error
+ *
+ * the output is the normalized undistorted pixel just like cv::fisheye::undistortPoints with no P
+ */
+class UndistortionMap
+{
+public:
+
+	UndistortionMap();
+
+	UndistortionMap(cv::Mat K, cv::Mat D, cv::Size size, double max_error = UNDISTORTION_MAP_MAX_ERROR);
+
+	bool matches(cv::Mat K, cv::Mat D, cv::Size size) const;
+
+	bool hasSize(cv::Size size) const {
+		return !this->empty() && size == this->size;
+	}
+
+	/*
+	 * undistorts a single pixel
+	 */
+	cv::Point2f undistort(cv::Point2f px) const;
+
+	/*
+	 * undistorts a batch of pixels
+	 * all pixels outside of the grid are undistorted exactly with one call
+	 */
+	void undistort(const std::vector<cv::Point2f>& in, std::vector<cv::Point2f>& out) const;
+
+	/*
+	 * the largest interpolation error that was measured in pixels
+	 */
+	double getMaxError() const {
+		return maxError;
+	}
+
+	int getStep() const {
+		return step;
+	}
+
+	bool empty() const {
+		return nodes.empty();
+	}
+
+private:
+
+	cv::Mat K;
+	cv::Mat D;
+	cv::Size size;
+
+	int step; // pixels between grid nodes
+	int cols; // number of nodes in x
+	int rows; // number of nodes in y
+	std::vector<cv::Point2f> nodes; // the exact undistortion of each node. row major
+	double maxError;
+
+	void build(int step);
+
+	double measureError() const;
+
+	bool inGrid(cv::Point2f px) const {
+		return px.x >= 0 && px.y >= 0 && px.x <= (cols - 1) * step && px.y <= (rows - 1) * step;
+	}
+
+	cv::Point2f interpolate(cv::Point2f px) const;
+};
+
+#endif /* PAUVSI_VIO_INCLUDE_PAUVSI_VIO_UNDISTORTIONMAP_H_ */
@@ -6,6 +6,19 @@
  */
 
 #include <VIOEKF.h>
+#include <eigen3/Eigen/Cholesky>
+
+/*
+ * the cross product matrix of v
+ */
+static Eigen::Matrix3d skew(const Eigen::Vector3d& v)
+{
+	Eigen::Matrix3d m;
+	m << 0, -v(2), v(1),
+			v(2), 0, -v(0),
+			-v(1), v(0), 0;
+	return m;
+}
 
 VIOEKF::VIOEKF() {
 	this->gyroBiasX = 0;
@@ -16,7 +29,22 @@ VIOEKF::VIOEKF() {
 
 	ros::param::param<bool>("~convert2rad", convert2rad, CONVERT_2_RAD_DEFAULT);
 
-	stillPredicting = false;
+	int imuBufferLength;
+	ros::param::param<int>("~imu_buffer_length", imuBufferLength, IMU_BUFFER_LENGTH_DEFAULT);
+	this->imuBuffer.allocate(imuBufferLength);
+
+	double gyroNoiseDensity, accelNoiseDensity;
+	ros::param::param<double>("~gyro_noise_density", gyroNoiseDensity, GYRO_NOISE_DENSITY_DEFAULT);
+	ros::param::param<double>("~accel_noise_density", accelNoiseDensity, ACCEL_NOISE_DENSITY_DEFAULT);
+	this->preintegration.setNoise(gyroNoiseDensity, accelNoiseDensity);
+
+	int stateHistoryLength;
+	ros::param::param<int>("~state_history_length", stateHistoryLength, STATE_HISTORY_LENGTH_DEFAULT);
+	this->propagation.allocate(stateHistoryLength);
+
+	double odometrySmoothingTime;
+	ros::param::param<double>("~odometry_smoothing_time", odometrySmoothingTime, ODOMETRY_SMOOTHING_TIME_DEFAULT);
+	this->odometrySmoother.setSmoothingTime(odometrySmoothingTime);
 
 }
 
@@ -26,50 +54,319 @@ VIOEKF::~VIOEKF() {
 
 VIOState VIOEKF::update(VIOState in, Measurement z)
 {
-	//compute the full covariance for the entire pred step
+	this->updateInPlace(in, z);
+	return in;
+}
+
+/*
+ * fuses one linearized measurement into the error state estimate dx and its covariance P
+ * dx is the correction collected so far so the residual is first moved to it: y - H * dx
+ *
+ * K = P * H^T * S^-1 is solved with an LDLT of S instead of inverting it and P is updated in the
+ * Joseph form P = (I - K * H) * P * (I - K * H)^T + K * R * K^T which stays positive even if K is not quite optimal
+ * every matrix has a fixed maximum size so nothing is allocated
+ * returns false and changes nothing if S is not positive definite
+ */
+template<int MaxRows>
+static bool josephUpdate(Eigen::Matrix<double, ERROR_STATE_SIZE, ERROR_STATE_SIZE>& P, Eigen::Matrix<double, ERROR_STATE_SIZE, 1>& dx,
+		const Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, MaxRows, 1>& y,
+		const Eigen::Matrix<double, Eigen::Dynamic, ERROR_STATE_SIZE, Eigen::ColMajor, MaxRows, ERROR_STATE_SIZE>& H,
+		const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor, MaxRows, MaxRows>& R)
+{
+	typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor, MaxRows, MaxRows> MatrixS;
+	typedef Eigen::Matrix<double, ERROR_STATE_SIZE, Eigen::Dynamic, Eigen::ColMajor, ERROR_STATE_SIZE, MaxRows> MatrixK;
 
-	Eigen::Matrix<double, 16, 16> F = this->stateJacobian(x_start_state, in.getTime().toSec() - x_start_state.getTime().toSec()); // compute the state transition jacobian
-	Eigen::Matrix<double, 16, 16> predictionError = this->computePredictionError(in.getTime().toSec() - x_start_state.getTime().toSec());
-	//propagate the error using the jacobian
-	in.covariance = F * in.covariance * F.transpose() + predictionError;
+	MatrixK PHt;
+	PHt.noalias() = P.lazyProduct(H.transpose());
 
-	//ROS_DEBUG_STREAM("new cov: " << in.covariance);
-	ROS_DEBUG_STREAM("used t: " << in.getTime().toSec() - x_start_state.getTime().toSec() << " for pred cov");
+	MatrixS S = R;
+	S.noalias() += H.lazyProduct(PHt);
+
+	// isPositive also accepts a singular S so every pivot must be clearly positive
+	// the comparison is false for nan too
+	Eigen::LDLT<MatrixS> ldlt(S);
+	if(ldlt.info() != Eigen::Success ||
+			!(ldlt.vectorD().minCoeff() > ERROR_STATE_MIN_RELATIVE_PIVOT * ldlt.vectorD().cwiseAbs().maxCoeff()))
+	{
+		return false;
+	}
 
-	stillPredicting = false;
+	// K^T = S^-1 * H * P because S and P are symmetric
+	MatrixK K = ldlt.solve(PHt.transpose()).transpose();
 
+	Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, MaxRows, 1> innovation = y;
+	innovation.noalias() -= H.lazyProduct(dx);
+	dx.noalias() += K.lazyProduct(innovation);
 
-	VIOState out = in;
+	// the Joseph form expanded with H * P * H^T + R = S so only 15 x m products are needed
+	// (I - K * H) * P * (I - K * H)^T + K * R * K^T = P - K * PHt^T - PHt * K^T + K * S * K^T
+	Eigen::Matrix<double, ERROR_STATE_SIZE, ERROR_STATE_SIZE> KPHt;
+	KPHt.noalias() = K.lazyProduct(PHt.transpose());
 
-	Eigen::Matrix<double, 7, 16> H;
-	H <<    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-			0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-			0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-			0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-			0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0,
-			0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0,
-			0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0;
+	MatrixK KS;
+	KS.noalias() = K.lazyProduct(S);
 
+	P -= KPHt + KPHt.transpose();
+	P.noalias() += KS.lazyProduct(K.transpose());
 
-	Eigen::Matrix<double, 7, 1> y = z.z - H*in.vector;
+	// remove the rounding asymmetry of K * S * K^T
+	P = 0.5 * (P + P.transpose()).eval();
 
-	Eigen::Matrix<double, 7, 7> S = H * in.covariance * H.transpose() + z.covariance;
+	return true;
+}
 
-	Eigen::Matrix<double, 16, 7> K = in.covariance * H.transpose() * S.inverse();
+/*
+ * applies the measurement to x. x's covariance was already propagated by the prediction
+ * x and its covariance are changed in place and the running state is restarted from x
+ */
+void VIOEKF::updateInPlace(VIOState& x, const Measurement& z)
+{
+	ErrorStateMeasurement m;
+	this->linearizePose(x, z, m);
 
-	out.vector = in.vector + K * y;
+	Eigen::Matrix<double, ERROR_STATE_SIZE, 1> dx = Eigen::Matrix<double, ERROR_STATE_SIZE, 1>::Zero();
+	if(!josephUpdate<ERROR_STATE_MEASUREMENT_MAX_DIM>(x.covariance, dx, m.y, m.H, m.R))
+	{
+		ROS_WARN_STREAM("the innovation covariance is not positive definite. skipping the update");
+		return;
+	}
 
-	out.covariance = (Eigen::MatrixXd::Identity(16, 16) - K*H) * in.covariance;
+	x.correct(dx);
 
-	return out;
+	// the samples after x were propagated from the old estimate
+	std::lock_guard<std::mutex> lock(this->propagationMutex);
+	this->anchorPropagation(x);
+}
+
+/*
+ * the corrections of every measurement are collected in one error state and applied to x at the end
+ * so every measurement can stay linearized about the predicted x
+ */
+int VIOEKF::updateBatch(VIOState& x, const std::vector<ErrorStateMeasurement>& batch, bool stacked)
+{
+	Eigen::Matrix<double, ERROR_STATE_SIZE, 1> dx = Eigen::Matrix<double, ERROR_STATE_SIZE, 1>::Zero();
+	int used = 0;
+
+	if(!stacked)
+	{
+		for(size_t i = 0; i < batch.size(); i++)
+		{
+			if(josephUpdate<ERROR_STATE_MEASUREMENT_MAX_DIM>(x.covariance, dx, batch[i].y, batch[i].H, batch[i].R))
+			{
+				used++;
+			}
+		}
+	}
+	else
+	{
+		// the measurements are stacked into blocks. R is block diagonal because their noises are independent
+		Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, ERROR_STATE_STACKED_MAX_DIM, 1> y;
+		Eigen::Matrix<double, Eigen::Dynamic, ERROR_STATE_SIZE, Eigen::ColMajor, ERROR_STATE_STACKED_MAX_DIM, ERROR_STATE_SIZE> H;
+		Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor, ERROR_STATE_STACKED_MAX_DIM, ERROR_STATE_STACKED_MAX_DIM> R;
+
+		size_t i = 0;
+		while(i < batch.size())
+		{
+			// count the measurements which fit in this block
+			int rows = 0;
+			size_t end = i;
+			while(end < batch.size() && rows + batch[end].dim() <= ERROR_STATE_STACKED_MAX_DIM)
+			{
+				rows += batch[end].dim();
+				end++;
+			}
+
+			y.resize(rows);
+			H.resize(rows, ERROR_STATE_SIZE);
+			R.setZero(rows, rows);
+
+			int row = 0;
+			for(size_t j = i; j < end; j++)
+			{
+				int d = batch[j].dim();
+				y.segment(row, d) = batch[j].y;
+				H.middleRows(row, d) = batch[j].H;
+				R.block(row, row, d, d) = batch[j].R;
+				row += d;
+			}
+
+			if(josephUpdate<ERROR_STATE_STACKED_MAX_DIM>(x.covariance, dx, y, H, R))
+			{
+				used += end - i;
+			}
+			else
+			{
+				// the rejected block is fused one measurement at a time so only the bad ones are dropped
+				for(size_t j = i; j < end; j++)
+				{
+					if(josephUpdate<ERROR_STATE_MEASUREMENT_MAX_DIM>(x.covariance, dx, batch[j].y, batch[j].H, batch[j].R))
+					{
+						used++;
+					}
+				}
+			}
+
+			i = end;
+		}
+	}
+
+	if(used == 0)
+	{
+		return 0;
+	}
+
+	x.correct(dx);
+
+	// the samples after x were propagated from the old estimate
+	std::lock_guard<std::mutex> lock(this->propagationMutex);
+	this->anchorPropagation(x);
+
+	return used;
+}
+
+/*
+ * the residual is the position error and the small world frame rotation from the state to the measured orientation
+ * H only selects the position and rotation blocks
+ */
+void VIOEKF::linearizePose(const VIOState& x, const Measurement& z, ErrorStateMeasurement& m)
+{
+	m.resize(6);
+
+	Eigen::Quaterniond q(x.q0(), x.q1(), x.q2(), x.q3());
+	Eigen::Quaterniond zq(z.z(3), z.z(4), z.z(5), z.z(6));
+	Eigen::Quaterniond dq = zq * q.conjugate();
+	if(dq.w() < 0)
+	{
+		dq.coeffs() *= -1; // take the short way around
+	}
+
+	m.y.head<3>() = z.z.head<3>() - x.vector.segment<3>(0);
+	m.y.tail<3>() = 2 * dq.vec();
+
+	m.H.block<3, 3>(0, ES_P).setIdentity();
+	m.H.block<3, 3>(3, ES_THETA).setIdentity();
+
+	// G maps the measured quaternion's noise onto the small angle: dtheta = 2 * vec(zq * q^-1)
+	Eigen::Matrix<double, 6, 7> G = Eigen::Matrix<double, 6, 7>::Zero();
+	G.topLeftCorner<3, 3>().setIdentity();
+	G.block<3, 1>(3, 3) = -2 * q.vec();
+	G.block<3, 3>(3, 4) = 2 * (q.w() * Eigen::Matrix3d::Identity() + skew(q.vec()));
+
+	Eigen::Matrix<double, 7, 6> RGt;
+	RGt.noalias() = z.covariance * G.transpose();
+	m.R.noalias() = G * RGt;
 }
 
 VIOState VIOEKF::predict(VIOState lastState, ros::Time predictionTime)
 {
-	if(!stillPredicting)
+	this->predictInPlace(lastState, predictionTime);
+	return lastState;
+}
+
+/*
+ * buffers the sample and moves the running state forward with it right away
+ * so the camera path does not have to integrate it later
+ */
+bool VIOEKF::addIMUMessage(const sensor_msgs::Imu& msg)
+{
+	ImuSample sample(msg, convert2rad);
+	if(!this->imuBuffer.push(sample))
+	{
+		ROS_WARN_STREAM_THROTTLE(1, "dropped an imu sample because the buffer is full or it is out of order. "
+				<< this->imuBuffer.getDropped() << " dropped so far");
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(this->propagationMutex);
+	this->propagateRunningState(sample);
+
+	return !this->propagation.empty() && this->propagation.back().getTime().toNSec() == sample.stamp;
+}
+
+/*
+ * the next prediction starts at the state the running state was last read at
+ * and the gyro integration starts at the last frame which is never older than t
+ */
+void VIOEKF::evictIMUBefore(ros::Time t)
+{
+	int64_t oldestNeeded = t.toNSec();
+	{
+		std::lock_guard<std::mutex> lock(this->propagationMutex);
+		if(!this->propagation.empty())
+		{
+			oldestNeeded = std::min(oldestNeeded, (int64_t)this->lastPropagationRead.toNSec());
+		}
+	}
+
+	const ImuSample* held = this->imuBuffer.atOrBefore(oldestNeeded);
+	if(held != NULL)
+	{
+		oldestNeeded = held->stamp;
+	}
+
+	this->imuBuffer.evictBefore(oldestNeeded);
+}
+
+/*
+ * copies the running state through the smoother so the output does not jump when a visual update lands
+ */
+bool VIOEKF::getOdometryState(VIOState& x, Eigen::Vector3d& omega)
+{
+	std::lock_guard<std::mutex> lock(this->propagationMutex);
+
+	if(this->propagation.empty())
+	{
+		return false;
+	}
+
+	const VIOState& running = this->propagation.back();
+	this->odometrySmoother.apply(running, x);
+
+	Eigen::Vector3d alpha;
+	this->getStateReading(running, alpha, omega);
+
+	return true;
+}
+
+/*
+ * moves the running state (the newest state in the history) to the sample's time and takes its reading
+ * does nothing until the running state is anchored or if the sample was already used
+ * the propagation mutex must be held
+ */
+void VIOEKF::propagateRunningState(const ImuSample& sample)
+{
+	if(this->propagation.empty())
 	{
-		x_start_state = lastState;
-		stillPredicting = true;
+		return;
+	}
+
+	VIOState x = this->propagation.back();
+	if(sample.stamp <= x.getTime().toNSec())
+	{
+		return;
+	}
+
+	double dt = sample.toSec() - x.getTime().toSec();
+	this->propagateCovariance(x, dt, x.covariance);
+	this->transitionStateInPlace(x, dt);
+	x.setTime(sample.getTime());
+	x.setIMU(sample);
+
+	this->propagation.push(x);
+}
+
+/*
+ * restarts the running state from x and propagates it through every buffered sample after x
+ * the jump between the old and new running state is handed to the odometry smoother
+ * the propagation mutex must be held
+ */
+void VIOEKF::anchorPropagation(const VIOState& x)
+{
+	bool wasRunning = !this->propagation.empty();
+	VIOState before;
+	if(wasRunning)
+	{
+		before = this->propagation.back();
 	}
 
 	//TODO either base or odom
@@ -80,33 +377,87 @@ VIOState VIOEKF::predict(VIOState lastState, ros::Time predictionTime)
 		ROS_WARN_STREAM(e.what());
 	}
 
-	VIOState state = lastState;
-	std::vector<sensor_msgs::Imu> imuMsgs;
-	int imuMsgsSize = this->getMessagesBetweenTimes(lastState.getTime(), predictionTime, imuMsgs);
+	this->propagation.clear();
+	this->propagation.push(x);
+	this->lastPropagationRead = x.getTime();
+
+	ImuSpan imuSamples = this->imuBuffer.between(x.getTime().toNSec(), std::numeric_limits<int64_t>::max());
+	for(int i = 0; i < imuSamples.size(); i++)
+	{
+		this->propagateRunningState(imuSamples[i]);
+	}
 
-	if(imuMsgsSize > 0)
+	if(wasRunning)
 	{
-		for(int i = 0; i < imuMsgs.size(); i++)
+		this->odometrySmoother.correct(before, this->propagation.back());
+	}
+}
+
+/*
+ * predicts the state and its covariance forward to the prediction time
+ *
+ * if the state is the one the running state was last read at, the imu samples were already integrated
+ * when they arrived. the state at the last sample before the prediction time is read from the history
+ * and only the final partial step is integrated
+ *
+ * otherwise (the first prediction or the history is too short) every buffered sample after the state's time
+ * is preintegrated once into preintegration and the running state is restarted from the result
+ */
+void VIOEKF::predictInPlace(VIOState& state, ros::Time predictionTime)
+{
+	std::lock_guard<std::mutex> lock(this->propagationMutex);
+
+	if(!this->propagation.empty() && state.timeSet && state.getTime().toNSec() == this->lastPropagationRead.toNSec())
+	{
+		const VIOState* x = this->propagation.atOrBefore(predictionTime);
+		if(x != NULL)
 		{
-			//this runs once to set the starting time of the system
-			// I had to do this because rosbag time was not working properly
-			if(!state.timeSet)
+			ImuSpan imuSamples = this->imuBuffer.between(state.getTime().toNSec(), predictionTime.toNSec());
+			if(!imuSamples.empty())
 			{
-				state.setTime(imuMsgs.at(i).header.stamp);
+				this->lastSampleUsed = imuSamples.back(); //set the last sample used to the final sample in the buffer
 			}
 
-			state = this->transitionState(state, imuMsgs.at(i).header.stamp.toSec() - state.getTime().toSec()); // predict and propagate
-			state.setIMU(imuMsgs.at(i)); // set the new alpha and omega
+			state = *x;
+
+			// the final partial step with the last sample's reading
+			double dt = predictionTime.toSec() - state.getTime().toSec();
+			this->propagateCovariance(state, dt, state.covariance);
+			this->transitionStateInPlace(state, dt);
+			state.setTime(predictionTime);
+
+			this->propagation.dropBefore(predictionTime);
+			this->lastPropagationRead = predictionTime;
+			return;
 		}
-		this->lastMessageUsed = imuMsgs.at(imuMsgs.size() - 1); //set the last message used to the final message in the buffer
 	}
 
-	//predict to the end
-	state = this->transitionState(state, predictionTime.toSec() - state.getTime().toSec());
-	// this sets the states omega and alpha to the last state's omega and alpha
+	// only the useful samples
+	ImuSpan imuSamples = this->imuBuffer.between(state.getTime().toNSec(), predictionTime.toNSec());
+
+	//this runs once to set the starting time of the system
+	// I had to do this because rosbag time was not working properly
+	if(!state.timeSet && !imuSamples.empty())
+	{
+		state.setTime(imuSamples[0].getTime());
+		state.setIMU(imuSamples[0]);
+	}
+
+	// the covariance is propagated over the whole step at once
+	this->propagateCovariance(state, predictionTime.toSec() - state.getTime().toSec(), state.covariance);
 
+	// integrate the samples once into deltas and move the state with them
+	this->preintegrateSamples(state, predictionTime, this->preintegration);
+	this->preintegration.predict(state, this->GRAVITY_MAG);
+	state.setTime(predictionTime);
 
-	return state;
+	if(!imuSamples.empty())
+	{
+		state.setIMU(imuSamples.back()); // this keeps the last imu sample's omega and alpha
+		this->lastSampleUsed = imuSamples.back(); //set the last sample used to the final sample in the buffer
+	}
+
+	this->anchorPropagation(state);
 }
 
 /*
@@ -115,37 +466,35 @@ VIOState VIOEKF::predict(VIOState lastState, ros::Time predictionTime)
  * NOTE: this function will keep the same imu reading as the last state x
  */
 VIOState VIOEKF::transitionState(VIOState x, double dt)
+{
+	this->transitionStateInPlace(x, dt);
+	return x;
+}
+
+/*
+ * this function will use the state's current imu measurment to predict x dt seconds into the future
+ * x is changed in place. its imu reading, biases and covariance are kept
+ */
+void VIOEKF::transitionStateInPlace(VIOState& x, double dt)
 {
 	//ROS_DEBUG_STREAM("transitioning state with dt = " << dt);
 	//ROS_DEBUG_STREAM("state before: " << x.vector);
 	// get the imu 2 com transform
 
-	//convert the imu readings to tf::Vectors and remove their biases
-	tf::Vector3 alpha_tf(x.getAlpha()(0), x.getAlpha()(1), x.getAlpha()(2));
-	alpha_tf = this->scaleAccelerometer * alpha_tf;
-	tf::Vector3 omega_tf(x.getOmega()(0) - this->gyroBiasX, x.getOmega()(1)- this->gyroBiasY, x.getOmega()(2) - this->gyroBiasZ);
-
-	//ROS_DEBUG_STREAM("original omega " << omega_tf.getX() << ", " << omega_tf.getY() << ", " << omega_tf.getZ());
-
-	//transform the imu readings into the center of mass frame
-	alpha_tf = imu2odom * alpha_tf - imu2odom * tf::Vector3(0.0, 0.0, 0.0);
-	omega_tf = imu2odom * omega_tf - imu2odom * tf::Vector3(0.0, 0.0, 0.0);
-
+	// the state's bias estimates are removed too so this agrees with the preintegrated prediction and with F
 	Eigen::Vector3d alpha, omega;
-	alpha << alpha_tf.getX(), alpha_tf.getY(), alpha_tf.getZ();
-	omega << omega_tf.getX(), omega_tf.getY(), omega_tf.getZ();
+	this->getStateReading(x, alpha, omega);
 
 	//ROS_DEBUG_STREAM("alpha " << alpha << "\n omega " << omega);
 
-	VIOState xNew;
-
 	//create quaternion to rotate the alpha vector
 	Eigen::Quaterniond q(x.q0(), x.q1(), x.q2(), x.q3());
 	//ROS_DEBUG_STREAM("q: " << q.w() << ", " << q.x() << ", " << q.y() << ", " << q.z());
-	alpha = q.toRotationMatrix() * alpha; // rotate alpha into world coordinate frame
+	Eigen::Matrix3d R = q.toRotationMatrix();
+	alpha = R * alpha; // rotate alpha into world coordinate frame
 
 	//experimental
-	omega = q.toRotationMatrix() * omega; // rotate alpha into world coordinate frame
+	omega = R * omega; // rotate alpha into world coordinate frame
 
 	// these equations are from matlab's quatrotate function
 	double ax = alpha(0);
@@ -166,10 +515,12 @@ VIOState VIOEKF::transitionState(VIOState x, double dt)
 
 	if(w_mag != 0)
 	{
-		dq0 = cos(0.5 * w_mag * dt);
-		dq1 = (omega(0) / w_mag) * sin(0.5 * w_mag * dt);
-		dq2 = (omega(1) / w_mag) * sin(0.5 * w_mag * dt);
-		dq3 = (omega(2) / w_mag) * sin(0.5 * w_mag * dt);
+		double c = cos(0.5 * w_mag * dt);
+		double s = sin(0.5 * w_mag * dt);
+		dq0 = c;
+		dq1 = (omega(0) / w_mag) * s;
+		dq2 = (omega(1) / w_mag) * s;
+		dq3 = (omega(2) / w_mag) * s;
 	}
 
 	Eigen::Quaterniond dq(dq0, dq1, dq2, dq3); // the delta quaternion
@@ -180,228 +531,256 @@ VIOState VIOEKF::transitionState(VIOState x, double dt)
 	newQ.normalize(); // normalize the final
 	//ROS_DEBUG_STREAM("dq * q: " << newQ.w() << ", " << newQ.x() << ", " << newQ.y() << ", " << newQ.z());
 
+	//transition state
+	// the positions are written before the velocities because they use the old velocities
+	x.vector(0, 0) += x.dx()*dt + 0.5 * ax * dt*dt;
+	x.vector(1, 0) += x.dy()*dt + 0.5 * ay * dt*dt;
+	x.vector(2, 0) += x.dz()*dt + 0.5 * (az - this->GRAVITY_MAG) * dt*dt;
+	x.vector(3, 0) += ax * dt;
+	x.vector(4, 0) += ay * dt;
+	x.vector(5, 0) += (az - this->GRAVITY_MAG) * dt;
 
+	x.vector(6, 0) = newQ.w();
+	x.vector(7, 0) = newQ.x();
+	x.vector(8, 0) = newQ.y();
+	x.vector(9, 0) = newQ.z();
 
-
-	//transition state
-	xNew.vector(0, 0) = x.x() + x.dx()*dt + 0.5 * ax * dt*dt;
-	//xNew.vector(0, 0) = x.x();
-	xNew.vector(1, 0) = x.y() + x.dy()*dt + 0.5 * ay * dt*dt;
-	//xNew.vector(1, 0) = x.y();
-	xNew.vector(2, 0) = x.z() + x.dz()*dt + 0.5 * (az - this->GRAVITY_MAG) * dt*dt;
-	//xNew.vector(2, 0) = x.z();
-	xNew.vector(3, 0) = x.dx() + ax * dt;
-	//xNew.vector(3, 0) = x.dx();
-	xNew.vector(4, 0) = x.dy() + ay * dt;
-	//xNew.vector(4, 0) = x.dy();
-	xNew.vector(5, 0) = x.dz() + (az - this->GRAVITY_MAG) * dt;
-	//xNew.vector(5, 0) = x.dz();
-
-	xNew.vector(6, 0) = newQ.w();
-	//xNew.vector(6, 0) = dq.w();
-	xNew.vector(7, 0) = newQ.x();
-	//xNew.vector(7, 0) = dq.x();
-	xNew.vector(8, 0) = newQ.y();
-	//xNew.vector(8, 0) = dq.y();
-	xNew.vector(9, 0) = newQ.z();
-	//xNew.vector(9, 0) = dq.z();
-
-	//ROS_DEBUG_STREAM("state after: " << xNew.vector);
-
-	//set the same imu reading
-	xNew.setAlpha(x.getAlpha());
-	xNew.setOmega(x.getOmega());
+	//ROS_DEBUG_STREAM("state after: " << x.vector);
 
 	//update the new state time
-	xNew.setTime(ros::Time(x.getTime().toSec() + dt));
+	x.setTime(ros::Time(x.getTime().toSec() + dt));
+}
+
+/*
+ * an imu reading with the ekf's biases and scale removed and moved into the center of mass frame
+ */
+void VIOEKF::getCoMReading(const Eigen::Vector3d& a_imu, const Eigen::Vector3d& w_imu, Eigen::Vector3d& alpha, Eigen::Vector3d& omega)
+{
+	//convert the imu readings to tf::Vectors and remove their biases
+	tf::Vector3 alpha_tf(a_imu(0), a_imu(1), a_imu(2));
+	alpha_tf = this->scaleAccelerometer * alpha_tf;
+	tf::Vector3 omega_tf(w_imu(0) - this->gyroBiasX, w_imu(1)- this->gyroBiasY, w_imu(2) - this->gyroBiasZ);
 
+	//ROS_DEBUG_STREAM("original omega " << omega_tf.getX() << ", " << omega_tf.getY() << ", " << omega_tf.getZ());
 
-	return xNew;
+	//transform the imu readings into the center of mass frame
+	alpha_tf = imu2odom * alpha_tf - imu2odom * tf::Vector3(0.0, 0.0, 0.0);
+	omega_tf = imu2odom * omega_tf - imu2odom * tf::Vector3(0.0, 0.0, 0.0);
+
+	alpha << alpha_tf.getX(), alpha_tf.getY(), alpha_tf.getZ();
+	omega << omega_tf.getX(), omega_tf.getY(), omega_tf.getZ();
 }
 
 /*
- * this constructs the jacobain of the state transition function
+ * the filter's bias estimates are in the center of mass frame like ImuPreintegration::predict expects them
  */
-Eigen::Matrix<double, 16, 16> VIOEKF::stateJacobian(VIOState state, double dt){
-
-	Eigen::Matrix<double, 16, 16> F;
-
-	double x = state.x();
-	double y = state.y();
-	double z = state.z();
-	double dx = state.dx();
-	double dy = state.dy();
-	double dz = state.dz();
-	double q0 = state.q0();
-	double q1 = state.q1();
-	double q2 = state.q2();
-	double q3 = state.q3();
-	double ax = state.getAlpha()(0);
-	double ay = state.getAlpha()(1);
-	double az = state.getAlpha()(2);
-	double wx = state.getOmega()(0);
-	double wy = state.getOmega()(1);
-	double wz = state.getOmega()(2);
-	double omegaMag = state.getOmega().norm();
-
-	//handle the two cases for omega
-	if(omegaMag > 0.0)
-	{
-		double s1 = (dt*omegaMag)/2;
-		double s2 = omegaMag;
-		double cs1 = cos(s1);
-		double ss1 = sin(s1);
-		double s3 = 4*q3*wx*wx*cs1*cs1*cs1 - 4*q3*wy*wy*cs1 - 4*q3*wz*wz*cs1 - 4*q3*wx*wx*cs1 +
-				4*q3*wy*wy*cs1*cs1*cs1 + 4*q3*wz*wz*cs1*cs1*cs1 - dt*q2*wy*wy*wy*cs1 + dt*q1*wy*wy*wy*cs1 -
-				dt*q0*wy*wy*wy*cs1 + dt*q1*wx*wx*wy*cs1 - dt*q2*wx*wy*wy*cs1 - dt*q0*wx*wx*wz*cs1 -
-				dt*q2*wx*wz*wz*cs1 - dt*q0*wy*wy*wz*cs1 + dt*q1*wy*wz*wz*cs1 + 2*dt*q3*s2*wx*wx*ss1 +
-				2*dt*q3*s2*wy*wy*ss1 + 2*dt*q3*s2*wz*wz*ss1 + 2*q2*s2*wx*cs1*cs1*ss1 - 2*q1*s2*wy*cs1*cs1*ss1 + 2*q0*s2*wz*cs1*cs1*ss1;
-		double s4 = 4*q2*wx*wx*cs1*cs1*cs1 - 4*q2*wy*wy*cs1 - 4*q2*wz*wz*cs1 - 4*q2*wx*wx*cs1 +
-				4*q2*wy*wy*cs1*cs1*cs1 + 4*q2*wz*wz*cs1*cs1*cs1 + dt*q3*wx*wx*wx*cs1 - dt*q0*wy*wy*wy*cs1 -
-				dt*q1*wz*wz*wz*cs1 - dt*q0*wx*wx*wy*cs1 + dt*q3*wx*wy*wy*cs1 - dt*q1*wx*wx*wz*cs1 +
-				dt*q3*wx*wz*wz*cs1 - dt*q0*wy*wz*wz*cs1 - dt*q1*wy*wy*wz*cs1 +
-				2*dt*q2*s2*wx*wx*ss1 + 2*dt*q2*s2*wy*wy*ss1 + 2*dt*q2*s2*wz*wz*ss1 -
-				2*q3*s2*wx*cs1*cs1*ss1 + 2*q0*s2*wy*cs1*cs1*ss1 + 2*q1*s2*wz*cs1*cs1*ss1;
-		double s5 = 4*q1*wx*wx*cs1*cs1*cs1 - 4*q1*wy*wy*cs1 - 4*q1*wz*wz*cs1 - 4*q1*wx*wx*cs1 +
-				4*q1*wy*wy*cs1*cs1*cs1 + 4*q1*wz*wz*cs1*cs1*cs1 - dt*q0*wx*wx*wx*cs1 - dt*q3*wy*wy*wy*cs1 +
-				dt*q2*wz*wz*wz*cs1 - dt*q0*wx*wy*wy*cs1 - dt*q3*wx*wx*wy*cs1 - dt*q0*wx*wz*wz*cs1 +
-				dt*q2*wx*wx*wz*cs1 + dt*q2*wy*wy*wz*cs1 - dt*q3*wy*wz*wz*cs1 + 2*dt*q1*s2*wx*wx*ss1 +
-				2*dt*q1*s2*wy*wy*ss1 + 2*dt*q1*s2*wz*wz*ss1 + 2*q0*s2*wx*cs1*cs1*ss1 +
-				2*q3*s2*wy*cs1*cs1*ss1 - 2*q2*s2*wz*cs1*cs1*ss1;
-		double s6 = 4*q0*wx*wx*cs1*cs1*cs1 - 4*q0*wy*wy*cs1 - 4*q0*wz*wz*cs1 - 4*q0*wx*wx*cs1 +
-				4*q0*wy*wy*cs1*cs1*cs1 + 4*q0*wz*wz*cs1*cs1*cs1 + dt*q1*wx*wx*wx*cs1 + dt*q2*wy*wy*wy*cs1 +
-				dt*q3*wz*wz*wz*cs1 + dt*q1*wx*wy*wy*cs1 + dt*q2*wx*wx*wy*cs1 + dt*q1*wx*wz*wz*cs1 +
-				dt*q3*wx*wx*wz*cs1 + dt*q2*wy*wz*wz*cs1 + dt*q3*wy*wy*wz*cs1 +
-				2*dt*q0*s2*wx*wx*ss1 + 2*dt*q0*s2*wy*wy*ss1 + 2*dt*q0*s2*wz*wz*ss1 -
-				2*q1*s2*wx*cs1*cs1*ss1 - 2*q2*s2*wy*cs1*cs1*ss1 - 2*q3*s2*wz*cs1*cs1*ss1;
-		double s7 = 5 - 3*cos(dt*s2);
-		double s8 = sqrt(2);
-		double s9 = 1/sqrt(s7);
-		double s10 = dt*dt;
-		double s11 = 1/(s2*s2*s2*s2);
-		double s12 = s12 = 1/s2;
-		double s13 = 2*s8*s9*s12*wx*ss1;
-		double s14 = 2*s8*s9*s12*wy*ss1;
-		double s15 = s8*s9*cs1;
-		double s16 = s9*s9;
-		double s17 = q0*q1 - q2*q3;
-		double s18 = q0*q3 - q1*q2;
-		double s19 = 2*s8*s9*s12*wz*ss1;
-		double s20 = az*q1;
-		double s21 = 2*ax*q2;
-		double s22 = s20 - ax*q3;
-		double s23 = 2*ay*q3;
-		double s24 = q2*q2;
-		double s25 = q1*q1;
-		double s26 = q3*q3;
-		double s27 = q0*q2;
-		double s28 = 2*ay*q2;
-		double s29 = 2*ax*q1;
-		double s30 = 2*ax*q0;
-		double s31 = 2*ay*q0;
-		double s32 = 2*az*q3;
-		double s33 = 2*az*q0;
-		double s34 = 2*s25;
-		double s35 = 2*s24;
-		double s36 = 2*s22;
-		double s37 = 2*s26;
-		double s38 = ay*q2;
-		double s39 = ax*q1;
-		double s40 = ay*q3;
-		double s41 = ax*q0;
-		double s42 = ay*q0;
-		double s43 = ax*q2;
-
-
-		F << 1, 0, 0, dt,  0,  0,  s10*(s40 - az*q2),           s10*(s38 + az*q3),  -s10*(s21 - ay*q1 + az*q0),     s10*(s22 + s42 - ax*q3),                      0,                      0,                      0, -s10*(s24 + s26 - 1/2),    s10*(q0*q3 + q1*q2),     -s10*(s27 - q1*q3),
-				0, 1, 0,  0, dt,  0,            s10*s22, s10*(s43 - 2*ay*q1 + az*q0),           s10*(s39 + az*q3),    -s10*(s23 + s41 - az*q2),                      0,                      0,                      0,               -s10*s18, -s10*(s25 + s26 - 1/2),    s10*(q0*q1 + q2*q3),
-				0, 0, 1,  0,  0, dt,  s10*(s43 - ay*q1),      -s10*(s20 + s22 + s42),   s10*(s40 + s41 - 2*az*q2),             s10*(s38 + s39),                      0,                      0,                      0,      s10*(s27 + q1*q3),               -s10*s17, -s10*(s24 + s25 - 1/2),
-				0, 0, 0,  1,  0,  0, dt*(s23 - 2*az*q2),              dt*(s28 + s32), -dt*(s33 + 4*s43 - 2*ay*q1),    dt*(s31 + s36 - 2*ax*q3),                      0,                      0,                      0,    -dt*(s35 + s37 - 1), dt*(2*q0*q3 + 2*q1*q2),    -2*dt*(s27 - q1*q3),
-				0, 0, 0,  0,  1,  0,             dt*s36,    dt*(s21 + s33 - 4*ay*q1),              dt*(s29 + s32), -dt*(s30 + 4*s40 - 2*az*q2),                      0,                      0,                      0,              -2*dt*s18,    -dt*(s34 + s37 - 1), dt*(2*q0*q1 + 2*q2*q3),
-				0, 0, 0,  0,  0,  1, dt*(s21 - 2*ay*q1),     -dt*(2*s20 + s31 + s36),    dt*(s23 + s30 - 4*az*q2),              dt*(s28 + s29),                      0,                      0,                      0,   dt*(2*s27 + 2*q1*q3),              -2*dt*s17,    -dt*(s34 + s35 - 1),
-				0, 0, 0,  0,  0,  0,                s15,                        -s13,                        -s14,                        -s19, -2*s6*s8*s9*s11*s16*wx, -2*s6*s8*s9*s11*s16*wy, -2*s6*s8*s9*s11*s16*wz,                      0,                      0,                      0,
-				0, 0, 0,  0,  0,  0,                s13,                         s15,                        -s19,                         s14, -2*s5*s8*s9*s11*s16*wx, -2*s5*s8*s9*s11*s16*wy, -2*s5*s8*s9*s11*s16*wz,                      0,                      0,                      0,
-				0, 0, 0,  0,  0,  0,                s14,                         s19,                         s15,                        -s13, -2*s4*s8*s9*s11*s16*wx, -2*s4*s8*s9*s11*s16*wy, -2*s4*s8*s9*s11*s16*wz,                      0,                      0,                      0,
-				0, 0, 0,  0,  0,  0,                s19,                        -s14,                         s13,                         s15, -2*s3*s8*s9*s11*s16*wx, -2*s3*s8*s9*s11*s16*wy, -2*s3*s8*s9*s11*s16*wz,                      0,                      0,                      0,
-				0, 0, 0,  0,  0,  0,                  0,                           0,                           0,                           0,                      1,                      0,                      0,                      0,                      0,                      0,
-				0, 0, 0,  0,  0,  0,                  0,                           0,                           0,                           0,                      0,                      1,                      0,                      0,                      0,                      0,
-				0, 0, 0,  0,  0,  0,                  0,                           0,                           0,                           0,                      0,                      0,                      1,                      0,                      0,                      0,
-				0, 0, 0,  0,  0,  0,                  0,                           0,                           0,                           0,                      0,                      0,                      0,                      1,                      0,                      0,
-				0, 0, 0,  0,  0,  0,                  0,                           0,                           0,                           0,                      0,                      0,                      0,                      0,                      1,                      0,
-				0, 0, 0,  0,  0,  0,                  0,                           0,                           0,                           0,                      0,                      0,                      0,                      0,                      0,                      1;
-	}
-	else
-	{
-		F = Eigen::MatrixXd::Identity(16, 16); // for now just set Identity in this case. TODO
-	}
+void VIOEKF::getStateReading(const VIOState& x, Eigen::Vector3d& alpha, Eigen::Vector3d& omega)
+{
+	this->getCoMReading(x.getAlpha(), x.getOmega(), alpha, omega);
+	omega -= x.vector.segment<3>(10);
+	alpha -= x.vector.segment<3>(13);
+}
+
+/*
+ * the two blocks of the error state transition which every other block is made from
+ * Fvt = -[R * alpha]x * dt and Fva = -R * dt
+ */
+void VIOEKF::transitionBlocks(const VIOState& x, double dt, Eigen::Matrix3d& Fvt, Eigen::Matrix3d& Fva)
+{
+	Eigen::Vector3d alpha, omega;
+	this->getStateReading(x, alpha, omega);
+
+	Eigen::Quaterniond q(x.q0(), x.q1(), x.q2(), x.q3());
+	Eigen::Matrix3d R = q.toRotationMatrix();
+
+	Fvt = -dt * skew(R * alpha);
+	Fva = -dt * R;
+}
+
+/*
+ * this constructs the dense jacobain of the error state transition function
+ * [dp, dv, dtheta, dbg, dba] which is
+ *
+ * | I  I*dt  Fvt*dt/2  0    Fva*dt/2 |
+ * | 0  I     Fvt       0    Fva      |
+ * | 0  0     I         Fva  0        |
+ * | 0  0     0         I    0        |
+ * | 0  0     0         0    I        |
+ *
+ * propagateCovariance uses the same blocks without building it
+ */
+Eigen::Matrix<double, ERROR_STATE_SIZE, ERROR_STATE_SIZE> VIOEKF::stateJacobian(const VIOState& state, double dt){
+
+	Eigen::Matrix3d Fvt, Fva;
+	this->transitionBlocks(state, dt, Fvt, Fva);
+
+	Eigen::Matrix<double, ERROR_STATE_SIZE, ERROR_STATE_SIZE> F;
+	F.setIdentity();
+	F.block<3, 3>(ES_P, ES_V) = dt * Eigen::Matrix3d::Identity();
+	F.block<3, 3>(ES_P, ES_THETA) = 0.5 * dt * Fvt;
+	F.block<3, 3>(ES_P, ES_BA) = 0.5 * dt * Fva;
+	F.block<3, 3>(ES_V, ES_THETA) = Fvt;
+	F.block<3, 3>(ES_V, ES_BA) = Fva;
+	F.block<3, 3>(ES_THETA, ES_BG) = Fva;
 
 	//ROS_DEBUG_STREAM("F = " << F);
 	return F;
 }
 
+/*
+ * P = F * P * F^T + Q over dt
+ * F is applied one 3 wide block row and then block column at a time
+ * only its seven non identity blocks are multiplied and the bias rows and columns are just copied
+ */
+void VIOEKF::propagateCovariance(const VIOState& x, double dt, Eigen::Matrix<double, ERROR_STATE_SIZE, ERROR_STATE_SIZE>& P)
+{
+	Eigen::Matrix3d Fvt, Fva;
+	this->transitionBlocks(x, dt, Fvt, Fva);
+	Eigen::Matrix3d Fpt = 0.5 * dt * Fvt;
+	Eigen::Matrix3d Fpa = 0.5 * dt * Fva;
+	const Eigen::Matrix3d& Ftg = Fva;
+
+	// A = F * P
+	Eigen::Matrix<double, ERROR_STATE_SIZE, ERROR_STATE_SIZE> A = P;
+	A.middleRows<3>(ES_P) += dt * P.middleRows<3>(ES_V);
+	A.middleRows<3>(ES_P).noalias() += Fpt * P.middleRows<3>(ES_THETA);
+	A.middleRows<3>(ES_P).noalias() += Fpa * P.middleRows<3>(ES_BA);
+	A.middleRows<3>(ES_V).noalias() += Fvt * P.middleRows<3>(ES_THETA);
+	A.middleRows<3>(ES_V).noalias() += Fva * P.middleRows<3>(ES_BA);
+	A.middleRows<3>(ES_THETA).noalias() += Ftg * P.middleRows<3>(ES_BG);
+
+	// P = A * F^T
+	P = A;
+	P.middleCols<3>(ES_P) += dt * A.middleCols<3>(ES_V);
+	P.middleCols<3>(ES_P).noalias() += A.middleCols<3>(ES_THETA) * Fpt.transpose();
+	P.middleCols<3>(ES_P).noalias() += A.middleCols<3>(ES_BA) * Fpa.transpose();
+	P.middleCols<3>(ES_V).noalias() += A.middleCols<3>(ES_THETA) * Fvt.transpose();
+	P.middleCols<3>(ES_V).noalias() += A.middleCols<3>(ES_BA) * Fva.transpose();
+	P.middleCols<3>(ES_THETA).noalias() += A.middleCols<3>(ES_BG) * Ftg.transpose();
+
+	P.diagonal() += this->computePredictionError(dt);
+}
+
 /*
  * this function tells the ekf how prediction error is related to time
+ * it returns the diagonal of Q for the error state
  */
-Eigen::Matrix<double, 16, 16> VIOEKF::computePredictionError(double dt)
+Eigen::Matrix<double, ERROR_STATE_SIZE, 1> VIOEKF::computePredictionError(double dt)
 {
-	Eigen::Matrix<double, 16, 16> PE = Eigen::MatrixXd::Identity(16, 16);
+	Eigen::Matrix<double, ERROR_STATE_SIZE, 1> PE;
 	double dts = dt*dt;
-	PE(0, 0) = dts + dt;
-	PE(1, 1) = dts + dt;
-	PE(2, 2) = dts + dt;
-	PE(3, 3) = dt;
-	PE(4, 4) = dt;
-	PE(5, 5) = dt;
-	PE(6, 6) = dt;
-	PE(7, 7) = dt;
-	PE(8, 8) = dt;
-	PE(9, 9) = dt;
-	PE(10, 10) = 0.03*dts;
-	PE(11, 11) = 0.03*dts;
-	PE(12, 12) = 0.03*dts;
-	PE(13, 13) = 0.03*dts;
-	PE(14, 14) = 0.03*dts;
-	PE(15, 15) = 0.03*dts;
+	PE.segment<3>(ES_P).setConstant(dts + dt);
+	PE.segment<3>(ES_V).setConstant(dt);
+	PE.segment<3>(ES_THETA).setConstant(dt);
+	PE.segment<3>(ES_BG).setConstant(0.03*dts);
+	PE.segment<3>(ES_BA).setConstant(0.03*dts);
 
 	return PE;
 }
 
 /*
- * gets all imu messages between the two times and places them in the returnBuffer
- * removes all imu messages before the final time
- * returns size of return buffer
+ * preintegrates the buffered imu samples between x's time and t1 into pim
+ * x's reading is held until the first sample like transitionState does and the last one until t1
+ * returns the number of imu samples used
+ */
+int VIOEKF::preintegrate(const VIOState& x, ros::Time t1, ImuPreintegration& pim)
+{
+	// imu2odom and the biases are shared with the imu callback
+	std::lock_guard<std::mutex> lock(this->propagationMutex);
+	return this->preintegrateSamples(x, t1, pim);
+}
+
+/*
+ * preintegrate for callers which already hold the propagation mutex
  */
-int VIOEKF::getMessagesBetweenTimes(ros::Time t0, ros::Time t1, std::vector<sensor_msgs::Imu>& returnBuffer)
+int VIOEKF::preintegrateSamples(const VIOState& x, ros::Time t1, ImuPreintegration& pim)
 {
-	int originalIMUBufferSize = this->imuMessageBuffer.size();
-	int returnBufferSize = 0;
+	pim.reset();
+
+	//TODO either base or odom
+	try{
+		tf_listener.lookupTransform(this->CoM_frame, this->imu_frame, ros::Time(0), imu2odom);
+	}
+	catch(tf::TransformException& e){
+		ROS_WARN_STREAM(e.what());
+	}
 
-	std::vector<sensor_msgs::Imu> newImuBuffer;
+	ImuSpan imuSamples = this->imuBuffer.between(x.getTime().toNSec(), t1.toNSec());
+	int imuSamplesSize = imuSamples.size();
 
-	double startTime = t0.toSec();
-	double endTime = t1.toSec();
+	Eigen::Vector3d alpha, omega;
+	this->getCoMReading(x.getAlpha(), x.getOmega(), alpha, omega);
 
-	// if there are messages in the imu buffer
-	if(originalIMUBufferSize > 0)
+	double t = x.getTime().toSec();
+	for(int i = 0; i <= imuSamplesSize; i++)
 	{
-		for(int i = 0; i < originalIMUBufferSize; i++)
-		{
-			double msgTime = this->imuMessageBuffer.at(i).header.stamp.toSec();
+		double tNext = (i < imuSamplesSize) ? imuSamples[i].toSec() : t1.toSec();
+		pim.integrate(alpha, omega, tNext - t);
+		t = tNext;
 
-			//if this message is useful
-			if(msgTime > startTime && msgTime < endTime)
-			{
-				returnBuffer.push_back(this->imuMessageBuffer.at(i));
-				returnBufferSize++;
-			}
-			if(msgTime > endTime)
-			{
-				newImuBuffer.push_back(this->imuMessageBuffer.at(i));
-			}
+		if(i < imuSamplesSize)
+		{
+			this->getCoMReading(imuSamples[i].getAccel(), imuSamples[i].getGyro(), alpha, omega);
 		}
 	}
 
-	return returnBufferSize;
+	return imuSamplesSize;
 }
 
+/*
+ * integrates the buffered gyro readings between t0 and t1 without touching the state
+ * dq is the rotation of the center of mass frame at t1 relative to t0
+ * (it rotates vectors in the t1 frame into the t0 frame)
+ * each reading is held forward until the next sample like preintegrate does
+ * returns the number of imu messages used. if it is 0 dq is the identity
+ */
+int VIOEKF::integrateGyro(ros::Time t0, ros::Time t1, Eigen::Quaterniond& dq)
+{
+	dq = Eigen::Quaterniond::Identity();
+
+	// imu2odom and the biases are shared with the imu callback
+	std::lock_guard<std::mutex> lock(this->propagationMutex);
+
+	ImuSpan imuSamples = this->imuBuffer.between(t0.toNSec(), t1.toNSec());
+	int imuSamplesSize = imuSamples.size();
+	if(imuSamplesSize == 0)
+	{
+		return 0;
+	}
+
+	try{
+		tf_listener.lookupTransform(this->CoM_frame, this->imu_frame, ros::Time(0), imu2odom);
+	}
+	catch(tf::TransformException& e){
+		ROS_WARN_STREAM(e.what());
+	}
+
+	// the reading at t0 is the newest sample at or before it
+	// if it was already evicted the first sample's reading stands in for it
+	const ImuSample* previous = this->imuBuffer.atOrBefore(t0.toNSec());
+
+	double t = t0.toSec();
+	for(int i = 0; i <= imuSamplesSize; i++)
+	{
+		// the reading over [t, tNext) is the one before it. the last is held until t1
+		const ImuSample& sample = (i > 0) ? imuSamples[i - 1] : ((previous != NULL) ? *previous : imuSamples[0]);
+		double tNext = (i < imuSamplesSize) ? imuSamples[i].toSec() : t1.toSec();
+		double dt = tNext - t;
+		t = tNext;
+
+		// remove the biases and move the reading into the center of mass frame
+		tf::Vector3 omega_tf(sample.gyro[0] - this->gyroBiasX, sample.gyro[1] - this->gyroBiasY, sample.gyro[2] - this->gyroBiasZ);
+		omega_tf = imu2odom.getBasis() * omega_tf;
+		Eigen::Vector3d omega(omega_tf.getX(), omega_tf.getY(), omega_tf.getZ());
+
+		double w_mag = omega.norm();
+		if(w_mag * dt != 0)
+		{
+			dq = dq * Eigen::Quaterniond(Eigen::AngleAxisd(w_mag * dt, omega / w_mag)); // body frame increment
+		}
+	}
+
+	dq.normalize();
+	return imuSamplesSize;
+}
 
@@ -10,6 +10,8 @@
 
 #include <vector>
 #include <string>
+#include <limits>
+#include <mutex>
 #include <ros/ros.h>
 #include <sensor_msgs/Imu.h>
 #include <sensor_msgs/Image.h>
@@ -22,9 +24,13 @@
 #include <Measurement.hpp>
 
 #include "pauvsi_vio/VIOState.hpp"
+#include "pauvsi_vio/ImuBuffer.h"
+#include "pauvsi_vio/ImuPreintegration.h"
+#include "pauvsi_vio/StateHistory.h"
+#include "pauvsi_vio/OdometrySmoother.h"
+#include "pauvsi_vio/ErrorStateMeasurement.h"
 #include <eigen3/Eigen/Geometry>
 
-#define PI 3.14156
 #define CONVERT_2_RAD_DEFAULT false
 
 class VIOEKF {
@@ -33,16 +39,14 @@ public:
 
 	virtual ~VIOEKF();
 
+	// the imu callback reads these while propagating so they are only written with the propagation mutex held
 	tf::StampedTransform imu2odom;
 
-	bool stillPredicting;
-	VIOState x_start_state;
-
 	double gyroBiasX;
 	double gyroBiasY;
 	double gyroBiasZ;
 	double scaleAccelerometer;
-	sensor_msgs::Imu lastMessageUsed;
+	ImuSample lastSampleUsed;
 
 	//frames
 	std::string imu_frame;
@@ -56,46 +60,147 @@ public:
 	 * for integration
 	 * The reason we don't integrate them right away is because there is a
 	 * slight gap it the time that the image is captured and when it is processed
+	 *
+	 * it is a fixed size ring filled by the imu callback and read by the camera pipeline
+	 * the vio evicts the samples no prediction can still need with evictIMUBefore
+	 */
+	ImuBuffer imuBuffer;
+
+	/*
+	 * the imu deltas of the last prediction
+	 * they can be corrected for a new bias estimate without integrating again
 	 */
-	std::vector<sensor_msgs::Imu> imuMessageBuffer;
+	ImuPreintegration preintegration;
+
+	/*
+	 * the filter state propagated with every imu sample as it arrives. the newest state is the running state
+	 * the camera path reads the state at the image time from it instead of integrating the samples itself
+	 * it is shared with the imu callback so it is only touched with the propagation mutex held
+	 */
+	StateHistory propagation;
+	ros::Time lastPropagationRead; // the time of the state the running state was last read or anchored at
+	std::mutex propagationMutex;
+
+	/*
+	 * smooths the jumps of the running state out of the imu rate odometry
+	 * it is fed by anchorPropagation so it is also guarded by the propagation mutex
+	 */
+	OdometrySmoother odometrySmoother;
 
 	tf::TransformListener tf_listener;
 
 	VIOState predict(VIOState lastState, ros::Time predictionTime);
 
+	/*
+	 * predicts state and its covariance forward to the prediction time in place
+	 * it is read from the running state if the samples were already integrated on arrival
+	 */
+	void predictInPlace(VIOState& state, ros::Time predictionTime);
+
 	VIOState update(VIOState lastState, Measurement z);
 
-	//STATE x STATE
-	Eigen::Matrix<double, 16, 16> stateJacobian(VIOState x, double dt);
+	/*
+	 * applies the measurement to the predicted x in place
+	 */
+	void updateInPlace(VIOState& x, const Measurement& z);
 
-	Eigen::Matrix<double, 16, 16> computePredictionError(double dt);
+	/*
+	 * applies a batch of measurements of any dimensions to the predicted x in place
+	 * every measurement must be linearized about x. their noises are assumed independent
+	 * they are either fused one at a time or stacked into blocks of up to ERROR_STATE_STACKED_MAX_DIM rows
+	 * both give the same result up to rounding. a measurement whose innovation covariance is not positive definite is dropped
+	 * (a stacked block which is rejected is fused one measurement at a time)
+	 * returns the number of measurements used
+	 */
+	int updateBatch(VIOState& x, const std::vector<ErrorStateMeasurement>& batch, bool stacked = false);
+
+	/*
+	 * linearizes a pose measurement about x into a 6 dim residual
+	 * [position error, small world frame rotation from x to the measured orientation]
+	 */
+	void linearizePose(const VIOState& x, const Measurement& z, ErrorStateMeasurement& m);
+
+	//ERROR STATE x ERROR STATE
+	Eigen::Matrix<double, ERROR_STATE_SIZE, ERROR_STATE_SIZE> stateJacobian(const VIOState& x, double dt);
+
+	/*
+	 * P = F * P * F^T + Q using the block structure of F
+	 * F is linearized at x and P is changed in place
+	 */
+	void propagateCovariance(const VIOState& x, double dt, Eigen::Matrix<double, ERROR_STATE_SIZE, ERROR_STATE_SIZE>& P);
+
+	Eigen::Matrix<double, ERROR_STATE_SIZE, 1> computePredictionError(double dt);
 
 	VIOState transitionState(VIOState x, double dt);
 
+	/*
+	 * moves x dt seconds into the future using its current imu reading
+	 * x's imu reading, biases and covariance are kept
+	 */
+	void transitionStateInPlace(VIOState& x, double dt);
+
 	void setGravityMagnitude(double g)
 	{
 		GRAVITY_MAG = g;
 	}
 
-	void addIMUMessage(sensor_msgs::Imu msg)
+	void setGyroBias(double x, double y, double z)
 	{
-		if(convert2rad)
-		{
-			msg.angular_velocity.x = PI / 180 * msg.angular_velocity.x;
-			msg.angular_velocity.y = PI / 180 * msg.angular_velocity.y;
-			msg.angular_velocity.z = PI / 180 * msg.angular_velocity.z;
-		}
-		this->imuMessageBuffer.push_back(msg);
+		std::lock_guard<std::mutex> lock(this->propagationMutex);
+		gyroBiasX = x;
+		gyroBiasY = y;
+		gyroBiasZ = z;
+	}
+
+	void setAccelerometerScale(double scale)
+	{
+		std::lock_guard<std::mutex> lock(this->propagationMutex);
+		scaleAccelerometer = scale;
 	}
 
-	int getMessagesBetweenTimes(ros::Time t0, ros::Time t1, std::vector<sensor_msgs::Imu>& returnBuffer);
+	/*
+	 * converts the message into a sample once, buffers it and propagates the running state with it
+	 * returns true if the running state was moved to the sample
+	 */
+	bool addIMUMessage(const sensor_msgs::Imu& msg);
+
+	/*
+	 * evicts the imu samples which are older than both t and the state the running state was last read at
+	 * the newest sample at or before that time is kept because its reading is held over the following step
+	 * NOTE: unlike the old message buffer this does not keep the samples back to the oldest frame still in
+	 * the window. so preintegrating from an older keyframe can find its samples gone. the imu edge in
+	 * VIO::twoViewBundleAdjustment (Motion.cpp) checks atOrBefore(keyframe time) and skips the edge then
+	 */
+	void evictIMUBefore(ros::Time t);
+
+	/*
+	 * the smoothed running state for the imu rate odometry output
+	 * omega is the newest angular velocity without biases in the center of mass frame
+	 * returns false if the running state has not been anchored yet
+	 */
+	bool getOdometryState(VIOState& x, Eigen::Vector3d& omega);
+
+	/*
+	 * preintegrates the buffered imu samples between x's time and t1 into pim
+	 * returns the number of imu samples used
+	 */
+	int preintegrate(const VIOState& x, ros::Time t1, ImuPreintegration& pim);
+
+	/*
+	 * integrates the buffered gyro readings between t0 and t1 without touching the state
+	 * dq is the rotation of the center of mass frame at t1 relative to t0
+	 * (it rotates vectors in the t1 frame into the t0 frame)
+	 * each reading is held forward until the next sample like preintegrate does
+	 * returns the number of imu messages used. if it is 0 dq is the identity
+	 */
+	int integrateGyro(ros::Time t0, ros::Time t1, Eigen::Quaterniond& dq);
 
-	sensor_msgs::Imu getMostRecentImu()
+	ImuSample getMostRecentImu()
 	{
-		if(imuMessageBuffer.empty())
-			return lastMessageUsed;
+		if(imuBuffer.empty())
+			return lastSampleUsed;
 
-		return imuMessageBuffer.back();
+		return imuBuffer.back();
 	}
 
 	tf::Quaternion getDifferenceQuaternion(tf::Vector3 v1, tf::Vector3 v2)
@@ -122,6 +227,26 @@ protected:
 
 	bool convert2rad;
 
+	/*
+	 * an imu reading without biases and scale in the center of mass frame
+	 */
+	void getCoMReading(const Eigen::Vector3d& a_imu, const Eigen::Vector3d& w_imu, Eigen::Vector3d& alpha, Eigen::Vector3d& omega);
+
+	/*
+	 * x's reading in the center of mass frame with x's own bias estimates removed as well
+	 * this is the reading the state transition and its jacobian are linearized at
+	 */
+	void getStateReading(const VIOState& x, Eigen::Vector3d& alpha, Eigen::Vector3d& omega);
+
+	void transitionBlocks(const VIOState& x, double dt, Eigen::Matrix3d& Fvt, Eigen::Matrix3d& Fva);
+
+	// these need the propagation mutex
+	void propagateRunningState(const ImuSample& sample);
+
+	int preintegrateSamples(const VIOState& x, ros::Time t1, ImuPreintegration& pim);
+
+	void anchorPropagation(const VIOState& x);
+
 	double GRAVITY_MAG;
 };
 
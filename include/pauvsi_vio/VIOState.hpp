@@ -10,69 +10,79 @@
 
 #include <eigen3/Eigen/Geometry>
 #include <iostream>
-#include <sensor_msgs/Imu.h>
+#include "pauvsi_vio/ImuSample.h"
 #include <opencv2/core/eigen.hpp>
 #include <tf/transform_listener.h>
 
+// the layout of the 15 dimensional error state. every block is 3 wide
+// the rotation error is a small angle in the world frame: q_true = exp(dtheta) * q
+#define ERROR_STATE_SIZE 15
+#define ES_P 0 // position
+#define ES_V 3 // velocity
+#define ES_THETA 6 // rotation
+#define ES_BG 9 // gyro bias
+#define ES_BA 12 // accel bias
+
 
 class VIOState
 {
 public:
 
 	Eigen::Matrix<double, 16, 1> vector; //x, y, z, dx, dy, dz, q0, q1, q2, q3, bgx, bgy, bgz, bax, bay, baz
-	Eigen::Matrix<double, 16, 16> covariance; // the covariance matrix for this state
+	Eigen::Matrix<double, ERROR_STATE_SIZE, ERROR_STATE_SIZE> covariance; // the covariance of the error state. see ES_*
 	bool timeSet;
 
 	VIOState(){
 		vector << 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0; // initialize the state vector
-		covariance = 0.001 * Eigen::MatrixXd::Identity(16, 16);
+		covariance.setIdentity();
+		covariance *= 0.001;
 		omega << 0, 0, 0;
 		alpha << 0, 0, 0;
 		timeSet = false;
 		//t = ros::Time::now();
 	}
 
-	double x(){
+	double x() const {
 		return vector(0, 0);
 	}
 
-	double y(){
+	double y() const {
 		return vector(1, 0);
 	}
 
-	double z(){
+	double z() const {
 		return vector(2, 0);
 	}
 
-	double dx(){
+	double dx() const {
 		return vector(3, 0);
 	}
 
-	double dy(){
+	double dy() const {
 		return vector(4, 0);
 	}
 
-	double dz(){
+	double dz() const {
 		return vector(5, 0);
 	}
 
-	double q0(){
+	double q0() const {
 		return vector(6, 0);
 	}
 
-	double q1(){
+	double q1() const {
 		return vector(7, 0);
 	}
 
-	double q2(){
+	double q2() const {
 		return vector(8, 0);
 	}
 
-	double q3(){
+	double q3() const {
 		return vector(9, 0);
 	}
 
-	void setOmega(Eigen::Vector3d omega)
+	void setOmega(const Eigen::Vector3d& omega)
 	{
 		this->omega = omega;
 	}
@@ -82,7 +92,7 @@ public:
 		this->setOmega(Eigen::Vector3d(x, y, z));
 	}
 
-	void setAlpha(Eigen::Vector3d alpha)
+	void setAlpha(const Eigen::Vector3d& alpha)
 	{
 		this->alpha = alpha;
 	}
@@ -92,10 +102,10 @@ public:
 		this->setAlpha(Eigen::Vector3d(x, y, z));
 	}
 
-	void setIMU(sensor_msgs::Imu msg)
+	void setIMU(const ImuSample& sample)
 	{
-		this->setAlpha(msg.linear_acceleration.x, msg.linear_acceleration.y, msg.linear_acceleration.z);
-		this->setOmega(msg.angular_velocity.x, msg.angular_velocity.y, msg.angular_velocity.z);
+		this->alpha = sample.getAccel();
+		this->omega = sample.getGyro();
 	}
 
 	void setTime(ros::Time t)
@@ -104,17 +114,17 @@ public:
 		this->t = t;
 	}
 
-	ros::Time getTime()
+	ros::Time getTime() const
 	{
 		return this->t;
 	}
 
-	Eigen::Vector3d getOmega()
+	const Eigen::Vector3d& getOmega() const
 	{
 		return this->omega;
 	}
 
-	Eigen::Vector3d getAlpha()
+	const Eigen::Vector3d& getAlpha() const
 	{
 		return this->alpha;
 	}
@@ -130,6 +140,14 @@ public:
 		return q;
 	}
 
+	void setQuaternion(const Eigen::Quaterniond& q)
+	{
+		vector(6, 0) = q.w();
+		vector(7, 0) = q.x();
+		vector(8, 0) = q.y();
+		vector(9, 0) = q.z();
+	}
+
 	void setQuaternion(tf::Quaternion q)
 	{
 		vector(6, 0) = q.getW();
@@ -138,6 +156,28 @@ public:
 		vector(9, 0) = q.getZ();
 	}
 
+	/*
+	 * adds an error state estimate to this state
+	 * the rotation error is applied on the left and the quaternion is renormalized
+	 */
+	void correct(const Eigen::Matrix<double, ERROR_STATE_SIZE, 1>& dx)
+	{
+		vector.segment<3>(0) += dx.segment<3>(ES_P);
+		vector.segment<3>(3) += dx.segment<3>(ES_V);
+
+		Eigen::Vector3d dtheta = dx.segment<3>(ES_THETA);
+		double angle = dtheta.norm();
+		if(angle > 0)
+		{
+			Eigen::Quaterniond q = Eigen::Quaterniond(Eigen::AngleAxisd(angle, dtheta / angle)) * this->getQuaternion();
+			q.normalize();
+			this->setQuaternion(q);
+		}
+
+		vector.segment<3>(10) += dx.segment<3>(ES_BG);
+		vector.segment<3>(13) += dx.segment<3>(ES_BA);
+	}
+
 	tf::Quaternion getTFQuaternion()
 	{
 		//ROS_DEBUG_STREAM("values " << q1() << ", " << q3() << ", " << q2() << ", " << q0());
@@ -20,6 +20,11 @@ VIO::VIO()
 	//feature tracker pass it its params
 	this->feature_tracker.setParams(FEATURE_SIMILARITY_THRESHOLD, MIN_EIGEN_VALUE,
 			KILL_BY_DISSIMILARITY, NUM_FEATURES, MIN_EIGEN_VALUE);
+	this->feature_tracker.setPredictedFlowParams(PREDICTED_FLOW_PYRAMID_LEVELS, PREDICTED_FLOW_MAX_ITERATIONS);
+	this->feature_tracker.setForwardBackwardParams(FORWARD_BACKWARD_CHECK, FORWARD_BACKWARD_THRESHOLD);
+	this->feature_tracker.setKillRadius(KILL_RADIUS);
+	// observations older than the frame buffer are always invalid so by default the window matches it
+	this->feature_tracker.map.setObservationWindow(std::max((OBSERVATION_WINDOW_LENGTH > 0) ? OBSERVATION_WINDOW_LENGTH : FRAME_BUFFER_LENGTH, 2));
 
 	//set up image transport
 	image_transport::ImageTransport it(nh);
@@ -37,11 +42,18 @@ VIO::VIO()
 	{
 		featurePub = nh.advertise<sensor_msgs::PointCloud>("/vio/points", 100);
 	}
+
+	//setup the imu rate odometry publisher
+	if(PUBLISH_ODOMETRY)
+	{
+		odometryPub = nh.advertise<nav_msgs::Odometry>(ODOMETRY_TOPIC, 100);
+	}
 	initialized = false; //not intialized yet
 
-	//push two frames into the fb
-	this->frameBuffer.push_front(Frame());
-	this->frameBuffer.push_front(Frame());
+	//allocate the frame buffer and push two frames into it
+	this->frameBuffer.allocate(std::max(this->FRAME_BUFFER_LENGTH, 2));
+	this->frameBuffer.push();
+	this->frameBuffer.push();
 
 	//ensure that both frames have a valid state
 	this->currentFrame().state = this->state;
@@ -56,22 +68,23 @@ VIO::~VIO()
 void VIO::cameraCallback(const sensor_msgs::ImageConstPtr& img, const sensor_msgs::CameraInfoConstPtr& cam)
 {
 	ros::Time start = ros::Time::now();
-	cv::Mat temp = cv_bridge::toCvShare(img, "mono8")->image.clone();
+	// this shares the message's data if it is already mono8
+	// the frame buffer copies it once into a reused slot so nothing is allocated in steady state
+	cv_bridge::CvImageConstPtr cv_img = cv_bridge::toCvShare(img, "mono8");
 
-	//set the K and D matrices
-	this->setK(get3x3FromVector(cam->K));
-	this->setD(cv::Mat(cam->D, false));
+	// the camera model is only rebuilt if the camera info changed
+	this->camera.update(*cam);
 
 	//undistort the image using the fisheye model
 	//ROS_ASSERT(cam->distortion_model == "fisheye");
 	//cv::fisheye::undistortImage(temp, temp, this->K, this->D, this->K);
 
 	// set the current frame
-	this->setCurrentFrame(temp, cv_bridge::toCvCopy(img, "mono8")->header.stamp);
+	this->setCurrentFrame(cv_img->image, img->header.stamp);
+	ROS_DEBUG_STREAM("frame image allocations: " << this->frameBuffer.getImageAllocations());
 
-	//set the current frame's K & D
-	this->currentFrame().K = this->K;
-	this->currentFrame().D = this->D;
+	//set the current frame's camera
+	this->currentFrame().camera = &this->camera;
 
 	// process the frame correspondences
 	this->run();
@@ -88,41 +101,39 @@ void VIO::cameraCallback(const sensor_msgs::ImageConstPtr& img, const sensor_msg
 void VIO::imuCallback(const sensor_msgs::ImuConstPtr& msg)
 {
 	//ROS_DEBUG_STREAM_THROTTLE(0.1, "accel: " << msg->linear_acceleration);
-	this->ekf.addIMUMessage(*msg);
-	//ROS_DEBUG_STREAM("time compare " << ros::Time::now().toNSec() - msg->header.stamp.toNSec());
-}
+	bool propagated = this->ekf.addIMUMessage(*msg);
 
-cv::Mat VIO::get3x3FromVector(boost::array<double, 9> vec)
-{
-	cv::Mat mat = cv::Mat(3, 3, CV_32F);
-	for(int i = 0; i < 3; i++)
+	// the running state was moved to this sample so the odometry goes out at the imu rate
+	VIOState x;
+	Eigen::Vector3d omega;
+	if(PUBLISH_ODOMETRY && propagated && this->ekf.getOdometryState(x, omega))
 	{
-		mat.at<float>(i, 0) = vec.at(3 * i + 0);
-		mat.at<float>(i, 1) = vec.at(3 * i + 1);
-		mat.at<float>(i, 2) = vec.at(3 * i + 2);
+		this->publishOdometry(x, omega);
 	}
-
-	ROS_DEBUG_STREAM_ONCE("K = " << mat);
-	return mat;
+	//ROS_DEBUG_STREAM("time compare " << ros::Time::now().toNSec() - msg->header.stamp.toNSec());
 }
 
-
 /*
  * sets the current frame and computes important
  * info about it
  * finds corners
  * describes corners
  */
-void VIO::setCurrentFrame(cv::Mat img, ros::Time t)
+void VIO::setCurrentFrame(const cv::Mat& img, ros::Time t)
 {
-	this->frameBuffer.push_front(Frame(img, t, lastFrame().nextFeatureID)); // create a frame with a starting ID of the last frame's next id
+	// the oldest frame's slot is reused once the buffer is full
+	// its generation changes so any point observation or keyframe which still refers to it is invalid
+	this->frameBuffer.push(img, t, lastFrame().nextFeatureID); // create a frame with a starting ID of the last frame's next id
 
-	// pop back if que is longer than the size
-	if(this->frameBuffer.size() > this->FRAME_BUFFER_LENGTH)
+	// only the current and last frame are used for optical flow so older pyramids are handed to the new frame
+	if(this->frameBuffer.size() > 2)
 	{
-		this->frameBuffer.pop_back();
-		//TODO remove any reference
+		this->currentFrame().takePyramidBuffers(this->frameBuffer.at(2));
 	}
+
+	// nothing integrates the imu from further back than the last frame so older samples can go
+	// evicting only before the oldest live frame would let a long frame buffer fill the imu ring
+	this->ekf.evictIMUBefore((this->frameBuffer.size() > 1) ? this->lastFrame().timeImageCreated : this->currentFrame().timeImageCreated);
 }
 
 void VIO::publishPoints()
@@ -176,6 +187,10 @@ void VIO::publishPoints()
  */
 void VIO::run()
 {
+	// only the vision thread's allocations are counted
+	AllocationProbe::watchThisThread();
+	unsigned long allocationsAtStart = AllocationProbe::count();
+
 	// if there is a last frame, flow features and estimate motion
 	if(lastFrame().isFrameSet())
 	{
@@ -184,11 +199,16 @@ void VIO::run()
 			ROS_DEBUG_STREAM("flow and clean start");
 			//ROS_DEBUG_STREAM("current frame address: " << &frameBuffer.at(0));
 			//ROS_DEBUG_STREAM("last frame address: " << &frameBuffer.at(1));
-			feature_tracker.flowFeaturesToNewFrame(this->frameBuffer.at(1), this->frameBuffer.at(0));
-			ROS_DEBUG("cleaning features");
-			currentFrame().cleanUpFeaturesByKillRadius(this->KILL_RADIUS);
-			ROS_DEBUG("cleaned up features");
-			//this->checkFeatureConsistency(currentFrame, this->FEATURE_SIMILARITY_THRESHOLD);
+			Eigen::Matrix3d R_c;
+			if(this->USE_GYRO_FLOW_PREDICTION && this->predictCameraRotation(this->frameBuffer.at(1), this->frameBuffer.at(0), R_c))
+			{
+				feature_tracker.flowFeaturesToNewFrame(this->frameBuffer.at(1), this->frameBuffer.at(0), &R_c);
+			}
+			else
+			{
+				feature_tracker.flowFeaturesToNewFrame(this->frameBuffer.at(1), this->frameBuffer.at(0));
+			}
+			// tracks outside of the kill radius were already culled by the tracker
 
 			currentFrame().undistortFeatures(); // undistort the new features
 			ROS_DEBUG_STREAM("flow and clean end");
@@ -198,7 +218,7 @@ void VIO::run()
 		this->lastState = this->state;
 
 		ros::Time t_start = ros::Time::now();
-		this->state = this->estimateMotion(this->lastState, this->lastFrame(), this->currentFrame());
+		this->estimateMotion(this->state, this->lastFrame(), this->currentFrame()); // state starts as the last state and is moved in place
 		ROS_DEBUG_STREAM("time for motion estimation: " << 1000 * (ros::Time::now().toSec() - t_start.toSec()));
 
 		//set the currentFrames new state
@@ -216,7 +236,8 @@ void VIO::run()
 		ros::Time t_start = ros::Time::now();
 		//add n new unique features
 		ROS_DEBUG_STREAM("low on features getting more: " << currentFrame().features.size());
-		int featuresAdded = currentFrame().getAndAddNewFeatures(this->NUM_FEATURES - currentFrame().features.size(), this->FAST_THRESHOLD, this->KILL_RADIUS, this->MIN_NEW_FEATURE_DISTANCE);
+		int featuresAdded = currentFrame().getAndAddNewFeatures(this->NUM_FEATURES - currentFrame().features.size(), this->FAST_THRESHOLD, this->KILL_RADIUS, this->MIN_NEW_FEATURE_DISTANCE,
+				this->DETECTION_GRID_ROWS, this->DETECTION_GRID_COLS);
 		ROS_DEBUG_STREAM("got more: " << currentFrame().features.size());
 
 		// this should contain the rotation and translation from the base of the system to the camera
@@ -239,26 +260,28 @@ void VIO::run()
 			ROS_DEBUG_STREAM("calculated avg scene depth is " << avg_scene_depth);
 		}
 
+		currentFrame().undistortFeatures(); // undistort the new features before their points are initialized
+
 		ROS_DEBUG_STREAM("need to add " << featuresAdded << "points. current map size: " << feature_tracker.map.size());
 		//this block adds a map point for the new feature added and links it to the new feature
-		for(std::vector<Feature>::iterator it = currentFrame().features.end() - featuresAdded; it != currentFrame().features.end(); it++)
+		for(int i = currentFrame().features.size() - featuresAdded; i < currentFrame().features.size(); i++)
 		{
-			feature_tracker.map.push_back(Point(&(*it))); // add a new map point linking it to the feature and therefore the frame
-			it->point = &feature_tracker.map.back(); // link the feature to the point and therefore all other matches
-			it->point->theMap = &feature_tracker.map; // link the map
-			it->point->thisPoint = --feature_tracker.map.end(); // give the point its iterator in the map
+			FeatureRef ft(&currentFrame(), i);
+			Point* pt = feature_tracker.map.insert(ft); // add a new map point linking it to the feature and therefore the frame
+			currentFrame().features.point[i] = pt; // link the feature to the point and therefore all other matches
 
 			//initialize the 3d point
-			it->point->initializePoint(c2w, &(*it), avg_scene_depth, DEFAULT_SCENE_DEPTH_CERTAINTY); // initialize the 3d point at the avg scene depth and with a very high uncertainty
-			ROS_ASSERT(it->point->initialized());
-			//ROS_ASSERT(it->point->pos(0) == it->point->thisPoint->pos(0));
+			pt->initializePoint(c2w, ft, avg_scene_depth, DEFAULT_SCENE_DEPTH_CERTAINTY); // initialize the 3d point at the avg scene depth and with a very high uncertainty
+			ROS_ASSERT(pt->initialized());
+			//ROS_ASSERT(feature_tracker.map.get(pt->handle) == pt);
 		}
 		ROS_DEBUG_STREAM("map size after adding: " << feature_tracker.map.size());
 
-
-		//currentFrame.describeFeaturesWithBRIEF();
-
-		currentFrame().undistortFeatures(); // undistort the new features
+		// describe the new features now so the next frame's consistency check has something to compare to
+		if(this->KILL_BY_DISSIMILARITY)
+		{
+			currentFrame().describeFeaturesWithBRIEF();
+		}
 
 		ROS_DEBUG_STREAM("3d point init dt: " << 1000 * (ros::Time::now().toSec() - t_start.toSec()));
 	}
@@ -266,10 +289,16 @@ void VIO::run()
 	this->broadcastWorldToOdomTF();
 	//this->publishPoints();
 
-	//ROS_DEBUG_STREAM("imu readings: " << this->imuMessageBuffer.size());
+	//ROS_DEBUG_STREAM("imu readings: " << this->ekf.imuBuffer.size());
 	ROS_DEBUG_STREAM("frame: " << this->frameBuffer.size() << " init: " << initialized);
 	ROS_DEBUG_STREAM("map points: " << this->feature_tracker.map.size());
 	ROS_DEBUG_STREAM(currentFrame().features.size());
+
+	ROS_DEBUG_STREAM("frame arena used " << FrameArena::get().getBytesUsed() << " of " << FrameArena::get().getCapacity() << " bytes");
+	ROS_DEBUG_STREAM_COND(AllocationProbe::enabled(), "heap allocations this frame: " << AllocationProbe::count() - allocationsAtStart);
+
+	// all scratch buffers of this frame are released at once
+	FrameArena::get().reset();
 }
 
 
@@ -278,7 +307,7 @@ void VIO::run()
  * uses an Extended Kalman Filter to predict and update the state and its
  * covariance.
  */
-VIOState VIO::estimateMotion(VIOState x, Frame& lf, Frame& cf)
+void VIO::estimateMotion(VIOState& x, Frame& lf, Frame& cf)
 {
 	//RECALIBRATION
 	static bool consecutiveRecalibration = false;
@@ -304,7 +333,7 @@ VIOState VIO::estimateMotion(VIOState x, Frame& lf, Frame& cf)
 	}
 
 	//MOTION ESTIMATION
-	VIOState newX = x; // set newX to last x
+	// x stays the last state unless the motion is estimated
 
 	//if the camera moves more than the minimum START distance
 	//start the motion estimate
@@ -316,13 +345,13 @@ VIOState VIO::estimateMotion(VIOState x, Frame& lf, Frame& cf)
 		//run ekf predict step.
 		//this will update the state using imu measurements
 		//it will also propagate the error throughout the predction step into the states covariance matrix
-		VIOState pred = ekf.predict(x, cf.timeImageCreated);
+		ekf.predictInPlace(x, cf.timeImageCreated);
 
 		//NEXT
 		//We must predict motion using either the triangulated 3d points or the key frames and their corresponding points
 		this->updateKeyFrameInfo(); // update the keyframe
 
-		frameBuffer.front().state = pred;
+		frameBuffer.front().state = x;
 
 		double start_time = ros::Time::now().toSec();
 		ROS_DEBUG("starting BA");
@@ -331,30 +360,11 @@ VIOState VIO::estimateMotion(VIOState x, Frame& lf, Frame& cf)
 
 
 		//TODO run the ekf update method on the predicted state using either gausss newton estimate or the fundamental + predict mag estimate
-
-
-		newX = pred;
-
-
-
 	}
 	else //REMOVE ALL IMU MESSAGES WHICH WERE NOT USED FROM THE BUFFER IF NOT INITIALIZED YET
 	{
-		std::vector<sensor_msgs::Imu> newBuff;
-
-		// empty the imu buffer
-		for(int i = 0; i < this->ekf.imuMessageBuffer.size(); i++)
-		{
-			if(this->ekf.imuMessageBuffer.at(i).header.stamp.toSec() >= cf.timeImageCreated.toSec())
-			{
-				newBuff.push_back(this->ekf.imuMessageBuffer.at(i));
-			}
-		}
-
-		this->ekf.imuMessageBuffer = newBuff; // replace the buffer
+		this->ekf.evictIMUBefore(cf.timeImageCreated);
 	}
-
-	return newX;
 }
 
 
@@ -398,6 +408,16 @@ void VIO::readROSParameters()
 
 	ros::param::param<int>("~min_new_feature_distance", MIN_NEW_FEATURE_DISTANCE, DEFAULT_MIN_NEW_FEATURE_DIST);
 
+	ros::param::param<int>("~detection_grid_rows", DETECTION_GRID_ROWS, DEFAULT_DETECTION_GRID_ROWS);
+	ros::param::param<int>("~detection_grid_cols", DETECTION_GRID_COLS, DEFAULT_DETECTION_GRID_COLS);
+
+	ros::param::param<bool>("~use_gyro_flow_prediction", USE_GYRO_FLOW_PREDICTION, DEFAULT_USE_GYRO_FLOW_PREDICTION);
+	ros::param::param<int>("~predicted_flow_pyramid_levels", PREDICTED_FLOW_PYRAMID_LEVELS, DEFAULT_PREDICTED_FLOW_PYRAMID_LEVELS);
+	ros::param::param<int>("~predicted_flow_max_iterations", PREDICTED_FLOW_MAX_ITERATIONS, DEFAULT_PREDICTED_FLOW_MAX_ITERATIONS);
+
+	ros::param::param<bool>("~forward_backward_check", FORWARD_BACKWARD_CHECK, DEFAULT_FORWARD_BACKWARD_CHECK);
+	ros::param::param<double>("~forward_backward_threshold", FORWARD_BACKWARD_THRESHOLD, DEFAULT_FORWARD_BACKWARD_THRESHOLD);
+
 	ros::param::param<double>("~starting_gravity_mag", GRAVITY_MAG, DEFAULT_GRAVITY_MAGNITUDE);
 
 	ros::param::param<double>("~recalibration_threshold", RECALIBRATION_THRESHOLD, DEFAULT_RECALIBRATION_THRESHOLD);
@@ -406,11 +426,16 @@ void VIO::readROSParameters()
 
 	ros::param::param<std::string>("~active_features_topic", ACTIVE_FEATURES_TOPIC, DEFAULT_ACTIVE_FEATURES_TOPIC);
 
+	ros::param::param<bool>("~publish_odometry", PUBLISH_ODOMETRY, DEFAULT_PUBLISH_ODOMETRY);
+
+	ros::param::param<std::string>("~odometry_topic", ODOMETRY_TOPIC, DEFAULT_ODOMETRY_TOPIC);
+
 	ros::param::param<double>("~min_triag_dist", MIN_TRIANGUALTION_DIST, DEFAULT_MIN_TRIANGUALTION_DIST);
 
 	ros::param::param<double>("~pixel_delta_init_thresh", INIT_PXL_DELTA, DEFAULT_INIT_PXL_DELTA);
 
 	ros::param::param<int>("~frame_buffer_length", FRAME_BUFFER_LENGTH, DEFAULT_FRAME_BUFFER_LENGTH);
+	ros::param::param<int>("~observation_window_length", OBSERVATION_WINDOW_LENGTH, DEFAULT_OBSERVATION_WINDOW_LENGTH);
 
 	ros::param::param<double>("~max_triangulation_error", MAX_TRIAG_ERROR, DEFAULT_MAX_TRIAG_ERROR);
 	ros::param::param<double>("~min_triangulation_z", MIN_TRIAG_Z, DEFAULT_MIN_TRIAG_Z);
@@ -428,6 +453,42 @@ void VIO::readROSParameters()
 	ros::param::param<double>("~average_scene_depth", START_SCENE_DEPTH, DEFAULT_SCENE_DEPTH);
 }
 
+/*
+ * integrates the gyro between the last and current frame and moves the rotation into the camera frame
+ * R rotates vectors in the current camera frame into the last camera frame
+ * returns false if there were no imu messages between the frames
+ */
+bool VIO::predictCameraRotation(Frame& lf, Frame& cf, Eigen::Matrix3d& R)
+{
+	Eigen::Quaterniond dq;
+	if(this->ekf.integrateGyro(lf.timeImageCreated, cf.timeImageCreated, dq) == 0)
+	{
+		return false;
+	}
+
+	// this should contain the rotation and translation from the base of the system to the camera
+	tf::StampedTransform b2c;
+	try {
+		this->ekf.tf_listener.lookupTransform(this->CoM_frame, this->camera_frame,
+				ros::Time(0), b2c);
+	} catch (tf::TransformException& e) {
+		ROS_WARN_STREAM(e.what());
+		return false;
+	}
+
+	Eigen::Matrix3d R_bc; // rotates camera vectors into the base frame
+	for(int i = 0; i < 3; i++)
+	{
+		for(int j = 0; j < 3; j++)
+		{
+			R_bc(i, j) = b2c.getBasis()[i][j];
+		}
+	}
+
+	R = R_bc.transpose() * dq.toRotationMatrix() * R_bc;
+	return true;
+}
+
 /*
  * broadcasts the world to odom transform
  */
@@ -443,6 +504,52 @@ void VIO::broadcastWorldToOdomTF()
 	br.sendTransform(tf::StampedTransform(transform, ros::Time::now(), this->world_frame, this->odom_frame));
 }
 
+/*
+ * publishes x as odometry of the center of mass in the world frame
+ * the pose covariance is the position and rotation blocks of x's error state covariance
+ * the twist is in the center of mass frame like nav_msgs/Odometry expects
+ * its angular covariance is the gyro bias uncertainty
+ */
+void VIO::publishOdometry(const VIOState& x, const Eigen::Vector3d& omega)
+{
+	nav_msgs::Odometry odom;
+	odom.header.stamp = x.getTime();
+	odom.header.frame_id = this->world_frame;
+	odom.child_frame_id = this->CoM_frame;
+
+	odom.pose.pose.position.x = x.x();
+	odom.pose.pose.position.y = x.y();
+	odom.pose.pose.position.z = x.z();
+	odom.pose.pose.orientation.w = x.q0();
+	odom.pose.pose.orientation.x = x.q1();
+	odom.pose.pose.orientation.y = x.q2();
+	odom.pose.pose.orientation.z = x.q3();
+
+	Eigen::Matrix3d R = Eigen::Quaterniond(x.q0(), x.q1(), x.q2(), x.q3()).toRotationMatrix();
+	Eigen::Vector3d v = R.transpose() * x.vector.segment<3>(3);
+
+	odom.twist.twist.linear.x = v(0);
+	odom.twist.twist.linear.y = v(1);
+	odom.twist.twist.linear.z = v(2);
+	odom.twist.twist.angular.x = omega(0);
+	odom.twist.twist.angular.y = omega(1);
+	odom.twist.twist.angular.z = omega(2);
+
+	// both are row major 6x6 matrices
+	Eigen::Map<Eigen::Matrix<double, 6, 6, Eigen::RowMajor> > poseCov(&odom.pose.covariance[0]);
+	poseCov.topLeftCorner<3, 3>() = x.covariance.block<3, 3>(ES_P, ES_P);
+	poseCov.topRightCorner<3, 3>() = x.covariance.block<3, 3>(ES_P, ES_THETA);
+	poseCov.bottomLeftCorner<3, 3>() = x.covariance.block<3, 3>(ES_THETA, ES_P);
+	poseCov.bottomRightCorner<3, 3>() = x.covariance.block<3, 3>(ES_THETA, ES_THETA);
+
+	Eigen::Map<Eigen::Matrix<double, 6, 6, Eigen::RowMajor> > twistCov(&odom.twist.covariance[0]);
+	twistCov.setZero();
+	twistCov.topLeftCorner<3, 3>() = R.transpose() * x.covariance.block<3, 3>(ES_V, ES_V) * R;
+	twistCov.bottomRightCorner<3, 3>() = x.covariance.block<3, 3>(ES_BG, ES_BG);
+
+	this->odometryPub.publish(odom);
+}
+
 /*
  * broadcasts the odom to tempIMU trans
  */
@@ -470,9 +577,9 @@ void VIO::recalibrateState(double avgPixelChange, double threshold, bool consecu
 	//ROS_DEBUG_STREAM("recalibrating with " << avgPixelChange);
 
 	static double lastNormalize = 0;
-	static sensor_msgs::Imu lastImu;
+	static ImuSample lastImu;
 	double normalize = avgPixelChange/threshold;
-	sensor_msgs::Imu currentImu = ekf.getMostRecentImu();
+	ImuSample currentImu = ekf.getMostRecentImu();
 
 	//ROS_DEBUG_STREAM("normalized pixel change " << normalize);
 
@@ -482,9 +589,9 @@ void VIO::recalibrateState(double avgPixelChange, double threshold, bool consecu
 	//TODO make a gyro bias measurment vector in the inertial motion estimator and do a weighted average
 
 	gyroNode gNode;
-	gNode.gyroBias.setX(currentImu.angular_velocity.x);
-	gNode.gyroBias.setY(currentImu.angular_velocity.y);
-	gNode.gyroBias.setZ(currentImu.angular_velocity.z);
+	gNode.gyroBias.setX(currentImu.gyro[0]);
+	gNode.gyroBias.setY(currentImu.gyro[1]);
+	gNode.gyroBias.setZ(currentImu.gyro[2]);
 	gNode.certainty = (1-normalize);
 	if(gyroQueue.size() >= DEFAULT_QUEUE_SIZE)
 	{
@@ -520,9 +627,8 @@ void VIO::recalibrateState(double avgPixelChange, double threshold, bool consecu
 		gWeightedNode.gyroBias.setZ(gWeightedNode.gyroBias.getZ() + gyroNormlizedCertainty.at(i)*gyroQueue.at(i).gyroBias.getZ());
 	}
 
-	ekf.gyroBiasX = gWeightedNode.gyroBias.getX();
-	ekf.gyroBiasY = gWeightedNode.gyroBias.getY();
-	ekf.gyroBiasZ = gWeightedNode.gyroBias.getZ();
+	// the imu callback reads the biases while propagating so they are set under its lock
+	ekf.setGyroBias(gWeightedNode.gyroBias.getX(), gWeightedNode.gyroBias.getY(), gWeightedNode.gyroBias.getZ());
 
 
 	//POTENTIAL BUG
@@ -532,9 +638,9 @@ void VIO::recalibrateState(double avgPixelChange, double threshold, bool consecu
 
 		ROS_DEBUG_STREAM("running consecutive calibration with new normalized " << normalize);
 
-		tf::Vector3 accel(lastImu.linear_acceleration.x*ekf.scaleAccelerometer
-				, lastImu.linear_acceleration.y*ekf.scaleAccelerometer
-				, lastImu.linear_acceleration.z*ekf.scaleAccelerometer);
+		tf::Vector3 accel(lastImu.accel[0]*ekf.scaleAccelerometer
+				, lastImu.accel[1]*ekf.scaleAccelerometer
+				, lastImu.accel[2]*ekf.scaleAccelerometer);
 		double scale = accel.length();
 
 		//Vector with size DEFAULT_QUEUE_SIZE, elements added at front and dequeued at back
@@ -598,7 +704,7 @@ void VIO::recalibrateState(double avgPixelChange, double threshold, bool consecu
 		//sum *= GRAVITY_MAG/queue.size();
 		//TODO create a ten element running wieghted average of the accelerometer scale.
 		if(scale != 0)
-			ekf.scaleAccelerometer = aWeightedNode.accelScale; // + (normalize)*ekf.scaleAccelerometer;
+			ekf.setAccelerometerScale(aWeightedNode.accelScale); // + (normalize)*ekf.scaleAccelerometer;
 
 		//tf::Vector3 gravity(0,0,GRAVITY_MAG);
 
@@ -21,6 +21,7 @@
 #include <sensor_msgs/Imu.h>
 #include <sensor_msgs/Image.h>
 #include <sensor_msgs/PointCloud.h>
+#include <nav_msgs/Odometry.h>
 #include "message_filters/subscriber.h"
 #include <image_transport/image_transport.h>
 #include <cv_bridge/cv_bridge.h>
@@ -52,6 +53,9 @@
 #include "VIOEKF.h"
 #include "VIOState.hpp"
 #include "KeyFrame.h"
+#include "FrameRing.h"
+#include "FrameArena.h"
+#include "AllocationProbe.h"
 
 
 #define SUPER_DEBUG true
@@ -65,6 +69,10 @@
 #define DEFAULT_MIN_EIGEN_VALUE 1e-4
 #define DEFAULT_NUM_FEATURES 50
 #define DEFAULT_MIN_NEW_FEATURE_DIST 10
+#define DEFAULT_DETECTION_GRID_ROWS 0 // 0 runs FAST over the whole image
+#define DEFAULT_DETECTION_GRID_COLS 0
+#define DEFAULT_USE_GYRO_FLOW_PREDICTION false
+#define DEFAULT_FORWARD_BACKWARD_CHECK false
 #define DEFAULT_IMU_FRAME_NAME "imu_frame"
 #define DEFAULT_ODOM_FRAME_NAME "odom"
 #define DEFAULT_CAMERA_FRAME_NAME "camera_frame"
@@ -75,9 +83,12 @@
 #define DEFAULT_QUEUE_SIZE 10
 #define DEFAULT_ACTIVE_FEATURES_TOPIC "/pauvsi_vio/activefeatures"
 #define DEFAULT_PUBLISH_ACTIVE_FEATURES false
+#define DEFAULT_ODOMETRY_TOPIC "/pauvsi_vio/odometry"
+#define DEFAULT_PUBLISH_ODOMETRY true
 #define DEFAULT_MIN_TRIANGUALTION_DIST 0.1
 #define DEFAULT_INIT_PXL_DELTA 1
 #define DEFAULT_FRAME_BUFFER_LENGTH 20
+#define DEFAULT_OBSERVATION_WINDOW_LENGTH -1 // the number of observations each point keeps. if not positive the frame buffer length is used
 #define DEFAULT_MAX_TRIAG_ERROR 1
 #define DEFAULT_MIN_TRIAG_Z 0.02
 #define DEFAULT_MIN_TRIAG_FEATURES 40
@@ -108,12 +119,20 @@ public:
 	bool KILL_BY_DISSIMILARITY;
 	int NUM_FEATURES;
 	int MIN_NEW_FEATURE_DISTANCE;
+	int DETECTION_GRID_ROWS;
+	int DETECTION_GRID_COLS;
+	bool USE_GYRO_FLOW_PREDICTION;
+	int PREDICTED_FLOW_PYRAMID_LEVELS;
+	int PREDICTED_FLOW_MAX_ITERATIONS;
+	bool FORWARD_BACKWARD_CHECK;
+	double FORWARD_BACKWARD_THRESHOLD;
 	double GRAVITY_MAG;
 	double RECALIBRATION_THRESHOLD;
 	bool PUBLISH_ACTIVE_FEATURES;
 	double MIN_TRIANGUALTION_DIST;
 	double INIT_PXL_DELTA;
 	int FRAME_BUFFER_LENGTH;
+	int OBSERVATION_WINDOW_LENGTH;
 	double MAX_TRIAG_ERROR;
 	double MIN_TRIAG_Z;
 	bool ROBUST_HUBER;
@@ -130,6 +149,9 @@ public:
 
 	std::string ACTIVE_FEATURES_TOPIC;
 
+	bool PUBLISH_ODOMETRY;
+	std::string ODOMETRY_TOPIC;
+
 	typedef Eigen::Matrix<double, 3, 4> Matrix3x4d;
 
 	//frames
@@ -147,13 +169,11 @@ public:
 
 	void cameraCallback(const sensor_msgs::ImageConstPtr& img, const sensor_msgs::CameraInfoConstPtr& cam);
 
-	cv::Mat get3x3FromVector(boost::array<double, 9> vec);
-
 	void correctOrientation(tf::Quaternion q, double certainty);
 
 	void readROSParameters();
 
-	void setCurrentFrame(cv::Mat frame, ros::Time t);
+	void setCurrentFrame(const cv::Mat& frame, ros::Time t);
 
 	Frame& currentFrame(){
 		return this->frameBuffer.at(0);
@@ -171,15 +191,11 @@ public:
 		return imuTopic;
 	}
 
-	void setK(cv::Mat _K){
-		K = _K;
-	}
+	void broadcastWorldToOdomTF();
 
-	void setD(cv::Mat _D){
-		D = _D;
-	}
+	void publishOdometry(const VIOState& x, const Eigen::Vector3d& omega);
 
-	void broadcastWorldToOdomTF();
+	bool predictCameraRotation(Frame& lf, Frame& cf, Eigen::Matrix3d& R);
 
 	ros::Time broadcastOdomToTempIMUTF(double roll, double pitch, double yaw, double x, double y, double z);
 
@@ -219,7 +235,7 @@ public:
 
 
 	//MOTION ESTIMATION
-	VIOState estimateMotion(VIOState x, Frame& frame1, Frame& frame2);
+	void estimateMotion(VIOState& x, Frame& frame1, Frame& frame2);
 
 	void updateKeyFrameInfo();
 
@@ -267,6 +283,7 @@ protected:
 	ros::Subscriber imuSub;
 
 	ros::Publisher featurePub;
+	ros::Publisher odometryPub;
 
 	//initialized with default values
 	std::string cameraTopic;
@@ -275,7 +292,7 @@ protected:
 	//Frame currentFrame; // the current frame
 	//Frame lastFrame; //the last frame
 
-	std::deque<Frame> frameBuffer; // holds frames
+	FrameRing frameBuffer; // holds frames. the slots are allocated once and reused
 	std::deque<KeyFrame> keyFrames; // holds information about the key frames
 
 	FeatureTracker feature_tracker;
@@ -297,8 +314,7 @@ protected:
 	std::vector<gyroNode> gyroQueue;
 	std::vector<accelNode> accelQueue;
 
-	cv::Mat K;
-	cv::Mat D;
+	CameraModel camera; // shared by all frames. rebuilt only when the camera info changes
 
 };
 
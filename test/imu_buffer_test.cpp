@@ -0,0 +1,181 @@
+/*
+ * imu_buffer_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: pauvsi
+ *
+ * checks the imu ring's searches and eviction across the wrap point and its drops
+ */
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+#include "ImuBuffer.h"
+
+/*
+ * a sample whose accel x is its stamp so it can be told apart
+ */
+static ImuSample sampleAt(int64_t stamp)
+{
+	ImuSample s;
+	s.stamp = stamp;
+	s.accel[0] = stamp;
+	return s;
+}
+
+/*
+ * fills a ring of 8 so the live samples wrap around its end
+ * slots 4-7 hold stamps 5-8 and slots 0-3 hold stamps 9-12
+ */
+static void fillWrapped(ImuBuffer& buffer)
+{
+	buffer.allocate(8);
+	for(int i = 1; i <= 6; i++)
+	{
+		ASSERT_TRUE(buffer.push(sampleAt(i)));
+	}
+	ASSERT_EQ(buffer.evictBefore(5), 4);
+	for(int i = 7; i <= 12; i++)
+	{
+		ASSERT_TRUE(buffer.push(sampleAt(i)));
+	}
+	ASSERT_EQ(buffer.size(), 8);
+}
+
+TEST(ImuBuffer, betweenAcrossTheWrap)
+{
+	ImuBuffer buffer;
+	fillWrapped(buffer);
+
+	// both ends are exclusive
+	ImuSpan s = buffer.between(5, 12);
+	ASSERT_EQ(s.size(), 6);
+	EXPECT_EQ(s.firstSize, 3);
+	EXPECT_EQ(s.secondSize, 3);
+	for(int i = 0; i < s.size(); i++)
+	{
+		EXPECT_EQ(s[i].stamp, 6 + i);
+		EXPECT_EQ(s[i].accel[0], 6 + i);
+	}
+	EXPECT_EQ(s.back().stamp, 11);
+
+	// a span which only lies after the wrap
+	s = buffer.between(9, 100);
+	ASSERT_EQ(s.size(), 3);
+	EXPECT_EQ(s.secondSize, 0);
+	EXPECT_EQ(s[0].stamp, 10);
+	EXPECT_EQ(s.back().stamp, 12);
+
+	// and one which is empty between two samples
+	EXPECT_TRUE(buffer.between(7, 8).empty());
+	EXPECT_TRUE(buffer.between(12, 100).empty());
+}
+
+TEST(ImuBuffer, atOrBeforeAcrossTheWrap)
+{
+	ImuBuffer buffer;
+	fillWrapped(buffer);
+
+	EXPECT_TRUE(buffer.atOrBefore(4) == NULL);
+	ASSERT_TRUE(buffer.atOrBefore(5) != NULL);
+	EXPECT_EQ(buffer.atOrBefore(5)->stamp, 5);
+	EXPECT_EQ(buffer.atOrBefore(8)->stamp, 8);
+	EXPECT_EQ(buffer.atOrBefore(9)->stamp, 9);
+	EXPECT_EQ(buffer.atOrBefore(11)->stamp, 11);
+	EXPECT_EQ(buffer.atOrBefore(100)->stamp, 12);
+	EXPECT_EQ(buffer.back().stamp, 12);
+}
+
+TEST(ImuBuffer, evictBeforeAcrossTheWrap)
+{
+	ImuBuffer buffer;
+	fillWrapped(buffer);
+
+	// nothing is older than the oldest sample
+	EXPECT_EQ(buffer.evictBefore(5), 0);
+
+	// the samples before the wrap go and the one at t stays
+	EXPECT_EQ(buffer.evictBefore(10), 5);
+	EXPECT_EQ(buffer.size(), 3);
+	EXPECT_EQ(buffer.atOrBefore(100)->stamp, 12);
+	EXPECT_TRUE(buffer.atOrBefore(9) == NULL);
+	EXPECT_EQ(buffer.between(0, 100)[0].stamp, 10);
+
+	// the freed slots are reused
+	for(int i = 13; i <= 17; i++)
+	{
+		EXPECT_TRUE(buffer.push(sampleAt(i)));
+	}
+	EXPECT_EQ(buffer.size(), 8);
+	EXPECT_EQ(buffer.between(0, 100).size(), 8);
+
+	EXPECT_EQ(buffer.evictBefore(100), 8);
+	EXPECT_TRUE(buffer.empty());
+	EXPECT_TRUE(buffer.between(0, 100).empty());
+	EXPECT_EQ(buffer.getDropped(), 0);
+}
+
+TEST(ImuBuffer, dropsOutOfOrderSamples)
+{
+	ImuBuffer buffer;
+	buffer.allocate(8);
+
+	EXPECT_TRUE(buffer.push(sampleAt(10)));
+	EXPECT_TRUE(buffer.push(sampleAt(20)));
+	EXPECT_FALSE(buffer.push(sampleAt(15)));
+	EXPECT_FALSE(buffer.push(sampleAt(5)));
+	EXPECT_EQ(buffer.getDropped(), 2);
+
+	// the ring stays sorted and a later sample is still taken
+	EXPECT_TRUE(buffer.push(sampleAt(30)));
+	ImuSpan s = buffer.between(0, 100);
+	ASSERT_EQ(s.size(), 3);
+	EXPECT_EQ(s[0].stamp, 10);
+	EXPECT_EQ(s[1].stamp, 20);
+	EXPECT_EQ(s[2].stamp, 30);
+
+	// an evicted sample's stamp still counts as out of order
+	buffer.evictBefore(100);
+	EXPECT_FALSE(buffer.push(sampleAt(25)));
+	EXPECT_EQ(buffer.getDropped(), 3);
+}
+
+TEST(ImuBuffer, dropsWhenFull)
+{
+	ImuBuffer buffer;
+	buffer.allocate(4);
+
+	for(int i = 1; i <= 4; i++)
+	{
+		EXPECT_TRUE(buffer.push(sampleAt(i)));
+	}
+	EXPECT_FALSE(buffer.push(sampleAt(5)));
+	EXPECT_FALSE(buffer.push(sampleAt(6)));
+	EXPECT_EQ(buffer.getDropped(), 2);
+
+	// the full ring is untouched
+	EXPECT_EQ(buffer.size(), 4);
+	EXPECT_EQ(buffer.back().stamp, 4);
+	EXPECT_EQ(buffer.atOrBefore(1)->stamp, 1);
+
+	// evicting makes room again
+	EXPECT_EQ(buffer.evictBefore(3), 2);
+	EXPECT_TRUE(buffer.push(sampleAt(7)));
+	EXPECT_TRUE(buffer.push(sampleAt(8)));
+	EXPECT_FALSE(buffer.push(sampleAt(9)));
+	EXPECT_EQ(buffer.getDropped(), 3);
+
+	ImuSpan s = buffer.between(0, 100);
+	ASSERT_EQ(s.size(), 4);
+	EXPECT_EQ(s[0].stamp, 3);
+	EXPECT_EQ(s[1].stamp, 4);
+	EXPECT_EQ(s[2].stamp, 7);
+	EXPECT_EQ(s[3].stamp, 8);
+}
+
+int main(int argc, char** argv)
+{
+	testing::InitGoogleTest(&argc, argv);
+	ros::Time::init(); // the drop warnings are throttled with ros time
+	return RUN_ALL_TESTS();
+}
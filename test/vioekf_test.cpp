@@ -0,0 +1,386 @@
+/*
+ * vioekf_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: pauvsi
+ *
+ * checks the hand written fast paths of the ekf against their dense definitions
+ * and the imu preintegration against integrating again and against sampled noise
+ */
+
+#include <random>
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <eigen3/Eigen/Cholesky>
+
+#include "VIOEKF.h"
+#include "VIOState.hpp"
+#include "ImuPreintegration.h"
+
+typedef Eigen::Matrix<double, ERROR_STATE_SIZE, ERROR_STATE_SIZE> CovarianceMatrix;
+
+/*
+ * a state with a random attitude, biases and imu reading
+ */
+static VIOState randomState()
+{
+	VIOState x;
+	x.vector.setRandom();
+	x.setQuaternion(Eigen::Quaterniond(Eigen::Vector4d::Random()).normalized());
+	x.setAlpha(Eigen::Vector3d::Random() * 10);
+	x.setOmega(Eigen::Vector3d::Random());
+	return x;
+}
+
+/*
+ * a random symmetric positive definite covariance
+ */
+static CovarianceMatrix randomCovariance()
+{
+	CovarianceMatrix A = CovarianceMatrix::Random();
+	return A * A.transpose() + 1e-3 * CovarianceMatrix::Identity();
+}
+
+/*
+ * propagateCovariance only multiplies the non identity blocks of F
+ * it must give F * P * F^T + Q with the dense jacobian
+ */
+TEST(VIOEKF, propagateCovarianceMatchesDenseJacobian)
+{
+	VIOEKF ekf;
+	srand(1);
+
+	double dts[] = {0.001, 0.005, 1.0 / 30};
+	for(int trial = 0; trial < 100; trial++)
+	{
+		VIOState x = randomState();
+		CovarianceMatrix P = randomCovariance();
+		double dt = dts[trial % 3];
+
+		CovarianceMatrix F = ekf.stateJacobian(x, dt);
+		CovarianceMatrix expected = F * P * F.transpose();
+		expected.diagonal() += ekf.computePredictionError(dt);
+
+		CovarianceMatrix actual = P;
+		ekf.propagateCovariance(x, dt, actual);
+
+		EXPECT_LE((actual - expected).cwiseAbs().maxCoeff(), 1e-12 * expected.cwiseAbs().maxCoeff()) << "dt " << dt;
+	}
+}
+
+/*
+ * a random measurement of the error state with a positive definite noise
+ */
+static ErrorStateMeasurement randomMeasurement(int dim)
+{
+	ErrorStateMeasurement m(dim);
+	m.y.setRandom();
+	m.H.setRandom();
+	ErrorStateMeasurement::Noise A = ErrorStateMeasurement::Noise::Random(dim, dim);
+	m.R = 0.1 * A * A.transpose() + 0.01 * ErrorStateMeasurement::Noise::Identity(dim, dim);
+	return m;
+}
+
+/*
+ * fuses the batch both ways into copies of x and expects the same state and covariance
+ */
+static void expectSequentialEqualsStacked(VIOEKF& ekf, const VIOState& x, const std::vector<ErrorStateMeasurement>& batch, int expectedUsed)
+{
+	VIOState sequential = x;
+	VIOState stacked = x;
+	EXPECT_EQ(ekf.updateBatch(sequential, batch, false), expectedUsed);
+	EXPECT_EQ(ekf.updateBatch(stacked, batch, true), expectedUsed);
+
+	EXPECT_LE((sequential.vector - stacked.vector).cwiseAbs().maxCoeff(), 1e-9);
+	EXPECT_LE((sequential.covariance - stacked.covariance).cwiseAbs().maxCoeff(), 1e-9 * x.covariance.cwiseAbs().maxCoeff());
+}
+
+/*
+ * independent measurements fused one at a time or stacked into blocks must give the same posterior
+ * the batches mix 2 and 6 dim measurements and span several stacked blocks
+ */
+TEST(VIOEKF, updateBatchSequentialEqualsStacked)
+{
+	VIOEKF ekf;
+	srand(2);
+
+	for(int trial = 0; trial < 20; trial++)
+	{
+		VIOState x = randomState();
+		x.covariance = randomCovariance();
+
+		std::vector<ErrorStateMeasurement> batch;
+		for(int i = 0; i < 10; i++)
+		{
+			batch.push_back(randomMeasurement((i % 3 == 0) ? 6 : 2));
+		}
+
+		expectSequentialEqualsStacked(ekf, x, batch, batch.size());
+	}
+}
+
+/*
+ * a measurement with a singular innovation covariance is dropped
+ * in stacked mode its block falls back to one at a time so the rest of the block is still used
+ */
+TEST(VIOEKF, updateBatchDropsSingularMeasurements)
+{
+	VIOEKF ekf;
+	srand(3);
+
+	VIOState x = randomState();
+	x.covariance = randomCovariance();
+
+	std::vector<ErrorStateMeasurement> batch;
+	for(int i = 0; i < 6; i++)
+	{
+		batch.push_back(randomMeasurement(2));
+	}
+	batch.at(2).H.setZero(); // S = R = 0
+	batch.at(2).R.setZero();
+
+	expectSequentialEqualsStacked(ekf, x, batch, batch.size() - 1);
+}
+
+/*
+ * predicts x over 30 samples at 200 Hz either through the running state fast path or the preintegrated fallback
+ */
+static VIOState predictOverSamples(const VIOState& x0, bool fastPath)
+{
+	VIOEKF ekf;
+	ekf.imu2odom.setIdentity();
+	srand(4);
+
+	ros::Time t1;
+	for(int i = 1; i <= 30; i++)
+	{
+		sensor_msgs::Imu msg;
+		msg.header.stamp = t1 = ros::Time(x0.getTime().toSec() + i * 0.005);
+		msg.linear_acceleration.x = 0.5 + 0.1 * (rand() % 10);
+		msg.linear_acceleration.y = -0.3;
+		msg.linear_acceleration.z = 9.8;
+		msg.angular_velocity.x = 0.2;
+		msg.angular_velocity.z = 0.05 * (rand() % 10);
+		ekf.addIMUMessage(msg);
+	}
+
+	VIOState x = x0;
+	if(fastPath)
+	{
+		// anchoring at x's own time integrates every sample into the running state
+		ekf.predictInPlace(x, x0.getTime());
+	}
+	ekf.predictInPlace(x, t1 + ros::Duration(0.002));
+	return x;
+}
+
+/*
+ * the running state and the preintegration must remove the state's bias estimates the same way
+ * otherwise the two prediction paths split apart as soon as an update corrects the biases
+ */
+TEST(VIOEKF, fastPathAndFallbackAgreeWithBiases)
+{
+	VIOState x0;
+	x0.setTime(ros::Time(10.0));
+	x0.setQuaternion(Eigen::Quaterniond(Eigen::AngleAxisd(0.3, Eigen::Vector3d(1, 2, 3).normalized())));
+	x0.setVelocity(Eigen::Vector3d(1, 0, 0.2));
+	x0.setAlpha(0.4, 0.1, 9.7);
+	x0.setOmega(0.1, 0, 0.2);
+	x0.vector.segment<3>(10) = Eigen::Vector3d(0.01, -0.02, 0.015); // gyro bias
+	x0.vector.segment<3>(13) = Eigen::Vector3d(0.05, 0.03, -0.04); // accel bias
+
+	VIOState fast = predictOverSamples(x0, true);
+	VIOState fallback = predictOverSamples(x0, false);
+
+	// the preintegration corrects the biases to first order so a small second order difference is left
+	// (1.6e-5 m/s here. ignoring the biases on one path is off by about dba * 0.15 s = 1e-2 m/s)
+	EXPECT_LE((fast.getr() - fallback.getr()).norm(), 1e-5);
+	EXPECT_LE((fast.getVelocity() - fallback.getVelocity()).norm(), 1e-4);
+	EXPECT_LE(fast.getQuaternion().angularDistance(fallback.getQuaternion()), 1e-6);
+
+	// and the check is not vacuous: without the biases the prediction is clearly different
+	VIOState unbiased = x0;
+	unbiased.vector.segment<6>(10).setZero();
+	VIOState withoutBiases = predictOverSamples(unbiased, true);
+	EXPECT_GT((fast.getVelocity() - withoutBiases.getVelocity()).norm(), 1e-3);
+}
+
+/*
+ * the rotation vector of q
+ */
+static Eigen::Vector3d logMap(const Eigen::Quaterniond& q)
+{
+	Eigen::AngleAxisd aa(q);
+	return aa.angle() * aa.axis();
+}
+
+/*
+ * a slowly varying center of mass reading for sample i
+ */
+static void testReading(int i, Eigen::Vector3d& alpha, Eigen::Vector3d& omega)
+{
+	alpha << 0.5 + 0.3 * sin(0.1 * i), -0.2 + 0.1 * cos(0.07 * i), 9.8 + 0.2 * sin(0.05 * i);
+	omega << 0.3 * cos(0.03 * i), -0.2, 0.5 + 0.1 * sin(0.09 * i);
+}
+
+/*
+ * the deltas corrected with the bias jacobians must agree with integrating the corrected readings again
+ * up to the second order in the bias error
+ */
+TEST(ImuPreintegration, biasCorrectionMatchesReintegration)
+{
+	const int n = 60;
+	const double dt = 0.005;
+	Eigen::Vector3d dbg(0.003, -0.002, 0.004);
+	Eigen::Vector3d dba(0.03, 0.02, -0.05);
+
+	ImuPreintegration pim, reintegrated;
+	for(int i = 0; i < n; i++)
+	{
+		Eigen::Vector3d alpha, omega;
+		testReading(i, alpha, omega);
+		pim.integrate(alpha, omega, dt);
+		reintegrated.integrate(alpha - dba, omega - dbg, dt);
+	}
+
+	Eigen::Vector3d zero = Eigen::Vector3d::Zero();
+	Eigen::Quaterniond R = reintegrated.getDeltaRotation(zero);
+	Eigen::Vector3d v = reintegrated.getDeltaVelocity(zero, zero);
+	Eigen::Vector3d p = reintegrated.getDeltaPosition(zero, zero);
+
+	double rotError = pim.getDeltaRotation(dbg).angularDistance(R);
+	double velError = (pim.getDeltaVelocity(dbg, dba) - v).norm();
+	double posError = (pim.getDeltaPosition(dbg, dba) - p).norm();
+
+	// without the correction the deltas are off by about the bias error times the interval
+	double uncorrectedRot = pim.getDeltaRotation(zero).angularDistance(R);
+	double uncorrectedVel = (pim.getDeltaVelocity(zero, zero) - v).norm();
+	double uncorrectedPos = (pim.getDeltaPosition(zero, zero) - p).norm();
+
+	EXPECT_LE(rotError, 1e-3 * uncorrectedRot);
+	EXPECT_LE(velError, 1e-2 * uncorrectedVel);
+	EXPECT_LE(posError, 1e-2 * uncorrectedPos);
+}
+
+/*
+ * with no bias error the preintegrated prediction must land where the per sample transition does
+ */
+TEST(ImuPreintegration, deltasMatchPerSampleTransition)
+{
+	VIOEKF ekf;
+	ekf.imu2odom.setIdentity();
+	ekf.setGravityMagnitude(9.8);
+
+	VIOState x0;
+	x0.setTime(ros::Time(10.0));
+	x0.setQuaternion(Eigen::Quaterniond(Eigen::AngleAxisd(0.7, Eigen::Vector3d(-1, 2, 0.5).normalized())));
+	x0.setVelocity(Eigen::Vector3d(0.5, -1, 0.3));
+	x0.setAlpha(0.2, 0.1, 9.9);
+	x0.setOmega(0.1, -0.3, 0.2);
+	x0.vector.segment<6>(10).setZero();
+
+	std::vector<ImuSample> samples;
+	for(int i = 1; i <= 40; i++)
+	{
+		Eigen::Vector3d alpha, omega;
+		testReading(i, alpha, omega);
+
+		sensor_msgs::Imu msg;
+		msg.header.stamp = ros::Time(x0.getTime().toSec() + i * 0.005);
+		msg.linear_acceleration.x = alpha(0);
+		msg.linear_acceleration.y = alpha(1);
+		msg.linear_acceleration.z = alpha(2);
+		msg.angular_velocity.x = omega(0);
+		msg.angular_velocity.y = omega(1);
+		msg.angular_velocity.z = omega(2);
+		ekf.addIMUMessage(msg);
+		samples.push_back(ImuSample(msg, false));
+	}
+	ros::Time t1 = samples.back().getTime() + ros::Duration(0.003);
+
+	ImuPreintegration pim;
+	EXPECT_EQ(ekf.preintegrate(x0, t1, pim), samples.size());
+	VIOState preintegrated = x0;
+	pim.predict(preintegrated, 9.8);
+
+	VIOState transitioned = x0;
+	for(auto& e : samples)
+	{
+		ekf.transitionStateInPlace(transitioned, e.toSec() - transitioned.getTime().toSec());
+		transitioned.setIMU(e);
+	}
+	ekf.transitionStateInPlace(transitioned, t1.toSec() - transitioned.getTime().toSec());
+
+	EXPECT_NEAR(pim.getDeltaTime(), (t1 - x0.getTime()).toSec(), 1e-9);
+	EXPECT_LE((preintegrated.getr() - transitioned.getr()).norm(), 1e-9);
+	EXPECT_LE((preintegrated.getVelocity() - transitioned.getVelocity()).norm(), 1e-9);
+	EXPECT_LE(preintegrated.getQuaternion().angularDistance(transitioned.getQuaternion()), 1e-9);
+}
+
+/*
+ * the propagated covariance of [dtheta, dv, dp] must match the spread of the deltas
+ * when white noise with the configured densities is added to the readings
+ */
+TEST(ImuPreintegration, covarianceMatchesMonteCarlo)
+{
+	const int n = 40;
+	const int trials = 4000;
+	const double dt = 0.005;
+	const double gyroDensity = 0.01;
+	const double accelDensity = 0.1;
+
+	ImuPreintegration pim;
+	pim.setNoise(gyroDensity, accelDensity);
+	for(int i = 0; i < n; i++)
+	{
+		Eigen::Vector3d alpha, omega;
+		testReading(i, alpha, omega);
+		pim.integrate(alpha, omega, dt);
+	}
+
+	Eigen::Vector3d zero = Eigen::Vector3d::Zero();
+	Eigen::Quaterniond R = pim.getDeltaRotation(zero);
+	Eigen::Vector3d v = pim.getDeltaVelocity(zero, zero);
+	Eigen::Vector3d p = pim.getDeltaPosition(zero, zero);
+
+	// a reading held for dt has a standard deviation of density / sqrt(dt)
+	std::mt19937 gen(7);
+	std::normal_distribution<double> gyroNoise(0, gyroDensity / sqrt(dt));
+	std::normal_distribution<double> accelNoise(0, accelDensity / sqrt(dt));
+
+	Eigen::Matrix<double, 9, 9> sampleCovariance = Eigen::Matrix<double, 9, 9>::Zero();
+	for(int trial = 0; trial < trials; trial++)
+	{
+		ImuPreintegration noisy;
+		for(int i = 0; i < n; i++)
+		{
+			Eigen::Vector3d alpha, omega;
+			testReading(i, alpha, omega);
+			alpha += Eigen::Vector3d(accelNoise(gen), accelNoise(gen), accelNoise(gen));
+			omega += Eigen::Vector3d(gyroNoise(gen), gyroNoise(gen), gyroNoise(gen));
+			noisy.integrate(alpha, omega, dt);
+		}
+
+		Eigen::Matrix<double, 9, 1> e;
+		e << logMap(R.conjugate() * noisy.getDeltaRotation(zero)),
+				noisy.getDeltaVelocity(zero, zero) - v,
+				noisy.getDeltaPosition(zero, zero) - p;
+		sampleCovariance += e * e.transpose() / trials;
+	}
+
+	// whitened by the predicted covariance the sample covariance must be close to the identity
+	Eigen::LLT<Eigen::Matrix<double, 9, 9> > llt(pim.getCovariance());
+	ASSERT_EQ(llt.info(), Eigen::Success);
+	Eigen::Matrix<double, 9, 9> L = llt.matrixL();
+	Eigen::Matrix<double, 9, 9> Linv = L.inverse();
+	Eigen::Matrix<double, 9, 9> whitened = Linv * sampleCovariance * Linv.transpose();
+
+	EXPECT_LE((whitened - Eigen::Matrix<double, 9, 9>::Identity()).cwiseAbs().maxCoeff(), 0.12) << whitened;
+}
+
+int main(int argc, char** argv)
+{
+	testing::InitGoogleTest(&argc, argv);
+	ros::init(argc, argv, "vioekf_test"); // the ekf's tf listener needs a node handle
+	return RUN_ALL_TESTS();
+}